@@ -59,7 +59,7 @@ void Account::changePassword(const string_t& newPassword)
     password[newPassword.length()] = '\0';
 }
 
-void LoggingSituation::logIn(string_t logID, int priority, int bookOffset)
+void LoggingSituation::logIn(string_t logID, int priority, offset_t bookOffset)
 {
     ++_logged_num;
     _logged_in_ID.emplace_back(std::move(logID));
@@ -67,7 +67,7 @@ void LoggingSituation::logIn(string_t logID, int priority, int bookOffset)
     _selected_book_offset.push_back(bookOffset);
 }
 
-void LoggingSituation::select(int bookOffset)
+void LoggingSituation::select(offset_t bookOffset)
 {
     _selected_book_offset.back() = bookOffset;
 }
@@ -110,26 +110,15 @@ int LoggingSituation::getPriority() const
     else return _logged_in_priority.back();
 }
 
-int LoggingSituation::getSelected() const
+offset_t LoggingSituation::getSelected() const
 {
     return _selected_book_offset.back();
 }
 
 AccountGroup::AccountGroup()
 {
-    std::ifstream tester("account");
-    if (tester.good()) { // such file exists
-        tester.close();
-        _accounts.open("account");
-    } else { // no such file
-        tester.close();
-
-        // create file "account"
-        std::ofstream fileCreator("account");
-        fileCreator.close();
-
-        // add default root user
-        _accounts.open("account");
+    // add default root user to a new file
+    if (_accounts.size() == 0) {
         Account account("root", "sjtu", "root", 7);
         _add_user(account);
     }
@@ -137,9 +126,9 @@ AccountGroup::AccountGroup()
 
 void AccountGroup::_add_user(const Account& account)
 {
-    _accounts.seekp(0, std::ios::end);
-    _id_index.insert(account.ID, _accounts.tellp());
-    _accounts.write(reinterpret_cast<const char*>(&account), sizeof(account));
+    offset_t position = _accounts.size();
+    _id_index.insert(account.ID, position);
+    _accounts.write(position, reinterpret_cast<const char*>(&account), sizeof(account));
 }
 
 void AccountGroup::switchUser(TokenScanner& line, LoggingSituation& logStatus, LogGroup& logs)
@@ -259,9 +248,8 @@ void AccountGroup::deleteUser(TokenScanner& line, const LoggingSituation& logSta
     // (to reduce the time of finding the same account,
     // an inline code instead of calling exist() is necessary.)
     UserID ID(userID);
-    int* position = _id_index.get(ID);
-    if (position == nullptr) throw InvalidCommand("Invalid");
-    delete position;
+    std::optional<offset_t> position = _id_index.get(ID);
+    if (!position) throw InvalidCommand("Invalid");
 
     // check whether this user has logged in
     if (logStatus.logged(userID)) throw InvalidCommand("Invalid");
@@ -282,32 +270,27 @@ void AccountGroup::deleteUser(TokenScanner& line, const LoggingSituation& logSta
 Account AccountGroup::find(const string_t& userID)
 {
     UserID ID(userID);
-    int* position = _id_index.get(ID);
-    if (position == nullptr) throw InvalidCommand("Invalid");
-    _accounts.seekg(*position);
-    delete position;
+    std::optional<offset_t> position = _id_index.get(ID);
+    if (!position) throw InvalidCommand("Invalid");
     Account account;
-    _accounts.read(reinterpret_cast<char*>(&account), sizeof(Account));
+    _accounts.read(*position, reinterpret_cast<char*>(&account), sizeof(Account));
     return account;
 }
 
 Account AccountGroup::find(const UserID& userID)
 {
-    int* position = _id_index.get(userID);
-    if (position == nullptr) throw InvalidCommand("Invalid");
-    _accounts.seekg(*position);
-    delete position;
+    std::optional<offset_t> position = _id_index.get(userID);
+    if (!position) throw InvalidCommand("Invalid");
     Account account;
-    _accounts.read(reinterpret_cast<char*>(&account), sizeof(Account));
+    _accounts.read(*position, reinterpret_cast<char*>(&account), sizeof(Account));
     return account;
 }
 
 bool AccountGroup::exist(const string_t& userID)
 {
     UserID ID(userID);
-    int* position = _id_index.get(ID);
-    if (position == nullptr) return false;
-    delete position;
+    std::optional<offset_t> position = _id_index.get(ID);
+    if (!position) return false;
     return true;
 }
 
@@ -325,30 +308,20 @@ void AccountGroup::changePassword(TokenScanner& line, const LoggingSituation& lo
     // (to reduce the time of finding the same account,
     // an inline code instead of calling exist() is necessary.)
     UserID ID(userID);
-    int* position = _id_index.get(ID);
-    if (position == nullptr) throw InvalidCommand("Invalid");
+    std::optional<offset_t> position = _id_index.get(ID);
+    if (!position) throw InvalidCommand("Invalid");
 
     // check the first password
-    if (!line.hasMoreToken()) {
-        delete position;
-        position = nullptr;
-        throw InvalidCommand("Invalid");
-    }
+    if (!line.hasMoreToken()) throw InvalidCommand("Invalid");
     string_t password1 = line.nextToken();
-    if (!validPassword(password1)) {
-        delete position;
-        position = nullptr;
-        throw InvalidCommand("Invalid");
-    }
+    if (!validPassword(password1)) throw InvalidCommand("Invalid");
 
     if (!line.hasMoreToken()) {
         if (logStatus.getPriority() == 7) {
             Account account;
-            _accounts.seekg(*position);
-            _accounts.read(reinterpret_cast<char*>(&account), sizeof(Account));
+            _accounts.read(*position, reinterpret_cast<char*>(&account), sizeof(Account));
             account.changePassword(password1);
-            _accounts.seekp(*position);
-            _accounts.write(reinterpret_cast<char*>(&account), sizeof(Account));
+            _accounts.write(*position, reinterpret_cast<char*>(&account), sizeof(Account));
 
             string_t logDescription;
             if (userID == logStatus.getID()) {
@@ -364,44 +337,24 @@ void AccountGroup::changePassword(TokenScanner& line, const LoggingSituation& lo
 
             std::cout << "Success" << std::endl;
         } else {
-            delete position;
-            position = nullptr;
             throw InvalidCommand("Invalid");
         }
     } else {
         Account account;
-        _accounts.seekg(*position);
-        _accounts.read(reinterpret_cast<char*>(&account), sizeof(Account));
+        _accounts.read(*position, reinterpret_cast<char*>(&account), sizeof(Account));
 
         //check the accuracy of old password
         for (int i = 0; i < password1.length(); ++i) {
-            if (password1[i] != account.password[i]) {
-                delete position;
-                position = nullptr;
-                throw InvalidCommand("Invalid");
-            }
-        }
-        if (account.password[password1.length()] != '\0') {
-            delete position;
-            position = nullptr;
-            throw InvalidCommand("Invalid");
+            if (password1[i] != account.password[i]) throw InvalidCommand("Invalid");
         }
+        if (account.password[password1.length()] != '\0') throw InvalidCommand("Invalid");
 
         // check the second password
         string_t password2 = line.nextToken();
-        if (line.hasMoreToken()) {
-            delete position;
-            position = nullptr;
-            throw InvalidCommand("Invalid");
-        }
-        if (!validPassword(password2)) {
-            delete position;
-            position = nullptr;
-            throw InvalidCommand("Invalid");
-        }
+        if (line.hasMoreToken()) throw InvalidCommand("Invalid");
+        if (!validPassword(password2)) throw InvalidCommand("Invalid");
         account.changePassword(password2);
-        _accounts.seekp(*position);
-        _accounts.write(reinterpret_cast<char*>(&account), sizeof(Account));
+        _accounts.write(*position, reinterpret_cast<char*>(&account), sizeof(Account));
 
         string_t logDescription;
         if (userID == logStatus.getID()) {
@@ -418,8 +371,6 @@ void AccountGroup::changePassword(TokenScanner& line, const LoggingSituation& lo
 
         std::cout << "Success" << std::endl;
     }
-
-    delete position;
 }
 
 void AccountGroup::flush()
@@ -4,7 +4,7 @@
 #include <iostream>
 #include <fstream>
 
-#include "unrolled_linked_list.h"
+#include "storage_engine.h"
 #include "token_scanner.h"
 #include "exception.h"
 
@@ -71,7 +71,7 @@ private:
 
     std::vector<int> _logged_in_priority; // to store the related priority
 
-    std::vector<int> _selected_book_offset; // to store the selected book id
+    std::vector<offset_t> _selected_book_offset; // to store the selected book id
 
 public:
     LoggingSituation() = default;
@@ -88,7 +88,7 @@ public:
      * @param priority
      * @param bookID
      */
-    void logIn(string_t logID, int priority, int bookOffset);
+    void logIn(string_t logID, int priority, offset_t bookOffset);
 
     /**
      * This function log out the account that is at the top of the
@@ -101,7 +101,7 @@ public:
      * of the logging stack.
      * @param bookOffset
      */
-    void select(int bookOffset);
+    void select(offset_t bookOffset);
 
     /**
      * This function check whether such ID is logged in.
@@ -119,14 +119,14 @@ public:
 
     [[nodiscard]] int getPriority() const;
 
-    [[nodiscard]] int getSelected() const;
+    [[nodiscard]] offset_t getSelected() const;
 };
 
 class AccountGroup {
 private:
-    UnrolledLinkedList<UserID, int> _id_index = UnrolledLinkedList<UserID, int>("account_index");
+    Index<UserID, offset_t> _id_index = Index<UserID, offset_t>("account_index");
 
-    std::fstream _accounts;
+    StorageFile _accounts = StorageFile("account");
 
     /**
      * This function add a user in the database.
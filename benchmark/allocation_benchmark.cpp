@@ -0,0 +1,212 @@
+// This benchmark counts the heap allocations on the path of the command
+// "buy": the lookup in the index of the ISBNs, the lookup of the book,
+// and the whole command (with and without the write-back after it).
+// It fails if any of them allocates.
+//
+// Usage: AllocationBenchmark [number of books] [number of commands]
+
+#include <cstdlib>
+#include <initializer_list>
+#include <new>
+#include <random>
+#include <streambuf>
+
+#include "../account.h"
+#include "../book.h"
+#include "../log.h"
+#include "benchmark.h"
+
+// the number of the heap allocations and their bytes so far
+long allocationCount = 0;
+
+long allocatedBytes = 0;
+
+void* operator new(size_t size)
+{
+    ++allocationCount;
+    allocatedBytes += static_cast<long>(size);
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+/**
+ * @class NullBuffer
+ *
+ * This is a stream buffer that drops everything, so that the outputs of
+ * the commands are not counted.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int character) override
+    {
+        return character;
+    }
+};
+
+/**
+ * @class AllocationCounter
+ *
+ * This counts the allocations of a step of the path in a row.
+ */
+class AllocationCounter {
+private:
+    std::string _label;
+
+    long _calls = 0;
+
+    long _count = 0;
+
+    long _bytes = 0;
+
+    long _count_before = 0;
+
+    long _bytes_before = 0;
+
+public:
+    explicit AllocationCounter(std::string label) : _label(std::move(label)) {}
+
+    void start()
+    {
+        _count_before = allocationCount;
+        _bytes_before = allocatedBytes;
+    }
+
+    void stop()
+    {
+        _count += allocationCount - _count_before;
+        _bytes += allocatedBytes - _bytes_before;
+        ++_calls;
+    }
+
+    [[nodiscard]] long count() const
+    {
+        return _count;
+    }
+
+    void print() const
+    {
+        std::printf("%-28s %10ld %14ld %14.3f %14.1f\n", _label.c_str(), _calls, _count,
+                    static_cast<double>(_count) / static_cast<double>(_calls),
+                    static_cast<double>(_bytes) / static_cast<double>(_calls));
+    }
+};
+
+/**
+ * This function returns the ISBN of the index-th book, which is short
+ * enough to be kept in a std::string without an allocation.
+ * @param index
+ */
+string_t isbnOf(int index)
+{
+    return "978" + std::to_string(1000000 + index);
+}
+
+int main(int argc, char** argv)
+{
+    const int bookCount = (argc > 1) ? std::atoi(argv[1]) : 20000;
+    const int commandCount = (argc > 2) ? std::atoi(argv[2]) : 100000;
+    NullBuffer nullBuffer;
+    std::streambuf* output = std::cout.rdbuf(&nullBuffer);
+
+    AllocationCounter indexLookup("index lookup (hit)"), missingLookup("index lookup (miss)"),
+                      bookLookup("book lookup"), buy("buy"), flush("write-back after buy");
+    {
+        ScratchContainer container;
+        std::mt19937 random(2021);
+        {
+            BookGroup books;
+            LogGroup logs;
+            LoggingSituation status;
+            status.logIn("root", 7, -1);
+
+            // Create the books with enough copies
+            for (int i = 0; i < bookCount; ++i) {
+                TokenScanner select(isbnOf(i));
+                books.select(select, status, logs);
+                TokenScanner price("-price=10.00");
+                books.modify(price, status, logs);
+                TokenScanner import("1000000 1.00");
+                books.importBook(import, status, logs);
+            }
+            books.flush();
+            logs.flush();
+
+            std::vector<string_t> lines;
+            for (int i = 0; i < commandCount; ++i) {
+                lines.push_back(isbnOf(static_cast<int>(random() % bookCount)) + " 1");
+            }
+            for (const string_t& text : lines) {
+                TokenScanner line(text);
+                buy.start();
+                books.buy(line, status, logs);
+                buy.stop();
+                flush.start();
+                books.flush();
+                logs.flush();
+                flush.stop();
+            }
+        }
+
+        // The steps of the path one by one, on the files closed above
+        std::vector<offset_t> offsets;
+        {
+            Index<ISBN, offset_t> isbns("book_index_ISBN");
+            for (int i = 0; i < commandCount; ++i) {
+                const ISBN isbn(isbnOf(static_cast<int>(random() % bookCount)));
+                indexLookup.start();
+                std::optional<offset_t> offset = isbns.get(isbn);
+                indexLookup.stop();
+                offsets.push_back(*offset);
+
+                const ISBN missing(isbnOf(bookCount + static_cast<int>(random() % bookCount)));
+                missingLookup.start();
+                offset = isbns.get(missing);
+                missingLookup.stop();
+            }
+        }
+        {
+            BookGroup books;
+            for (offset_t offset : offsets) {
+                bookLookup.start();
+                books.find(offset);
+                bookLookup.stop();
+            }
+        }
+    }
+
+    std::cout.rdbuf(output);
+    std::printf("%-28s %10s %14s %14s %14s\n", "step", "calls", "allocations", "per call", "bytes per call");
+    int result = 0;
+    for (const AllocationCounter* counter : {&indexLookup, &missingLookup, &bookLookup, &buy, &flush}) {
+        counter->print();
+        if (counter->count() != 0) result = 1;
+    }
+    if (result != 0) std::cout << "the path allocates" << std::endl;
+    return result;
+}
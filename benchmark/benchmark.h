@@ -0,0 +1,335 @@
+#ifndef BENCHMARK
+#define BENCHMARK
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../container.h"
+
+// The helpers shared by the benchmarks.  A benchmark replays a trace of
+// operations on an index of the ISBNs and an index of the (keyword,
+// ISBN) pairs, which are the largest indexes of the program.  The trace
+// is either generated, or recorded from the commands of the program.
+
+/**
+ * @struct FixedString
+ *
+ * This is a key of a fixed size, just like the ISBNs and the keywords
+ * of the program.
+ */
+template <int length>
+struct FixedString {
+    char text[length];
+
+    FixedString() : text{} {}
+
+    explicit FixedString(const std::string& source) : text{}
+    {
+        std::strncpy(text, source.c_str(), length - 1);
+    }
+
+    bool operator==(const FixedString& rhs) const
+    {
+        return std::strcmp(text, rhs.text) == 0;
+    }
+
+    bool operator<(const FixedString& rhs) const
+    {
+        return std::strcmp(text, rhs.text) < 0;
+    }
+};
+
+typedef FixedString<21> BenchmarkISBN;
+
+typedef FixedString<61> BenchmarkKeyword;
+
+/**
+ * @struct Operation{type, onKeyword, keyword, isbn, value}
+ *
+ * This is an operation of a trace.  It is on the index of the keywords
+ * if onKeyword is true, or on the index of the ISBNs otherwise (and then
+ * the keyword is not used).  A scan is always on the index of the
+ * keywords, and the ISBN is not used.
+ */
+struct Operation {
+    enum Type {insert, erase, get, scan};
+
+    Type type;
+
+    bool onKeyword;
+
+    std::string keyword;
+
+    std::string isbn;
+
+    offset_t value;
+};
+
+/**
+ * This function generates a trace like the one of a bookstore: the books
+ * are created with a few keywords each, and then looked up much more
+ * often than their keywords are changed.
+ * @param operationCount
+ * @param seed
+ */
+inline std::vector<Operation> generateTrace(size_t operationCount, unsigned seed = 2021)
+{
+    std::mt19937 random(seed);
+    std::vector<Operation> trace;
+    std::vector<std::string> isbns;
+    std::map<std::string, std::set<std::string>> keywords; // of the books
+    auto keywordOf = [&random]() { return "keyword" + std::to_string(random() % 2000); };
+
+    while (trace.size() < operationCount) {
+        const unsigned dice = random() % 100;
+        if (dice < 20 || isbns.empty()) { // a new book
+            const std::string isbn = "978" + std::to_string(random() % 1000000000);
+            if (keywords.count(isbn) != 0) continue;
+            const offset_t value = static_cast<offset_t>(isbns.size());
+            isbns.push_back(isbn);
+            trace.push_back(Operation{Operation::insert, false, "", isbn, value});
+            for (int i = 0; i < 3; ++i) {
+                const std::string keyword = keywordOf();
+                if (!keywords[isbn].insert(keyword).second) continue;
+                trace.push_back(Operation{Operation::insert, true, keyword, isbn, value});
+            }
+        } else if (dice < 30) { // a keyword is changed
+            const offset_t value = static_cast<offset_t>(random() % isbns.size());
+            const std::string& isbn = isbns[value];
+            std::set<std::string>& words = keywords[isbn];
+            if (!words.empty()) {
+                trace.push_back(Operation{Operation::erase, true, *words.begin(), isbn, 0});
+                words.erase(words.begin());
+            }
+            const std::string keyword = keywordOf();
+            if (words.insert(keyword).second) {
+                trace.push_back(Operation{Operation::insert, true, keyword, isbn, value});
+            }
+        } else if (dice < 95) { // a book is looked up (one in ten of them doesn't exist)
+            const std::string isbn = (dice < 40) ? "979" + std::to_string(random() % 1000000000) :
+                                     isbns[random() % isbns.size()];
+            trace.push_back(Operation{Operation::get, false, "", isbn, 0});
+        } else { // the books of a keyword are listed
+            trace.push_back(Operation{Operation::scan, true, keywordOf(), "", 0});
+        }
+    }
+    return trace;
+}
+
+/**
+ * This function records the operations on the indexes of the ISBNs and
+ * the keywords from the commands of the program (such as the inputs of
+ * the tests).  The privileges are not checked, so all the commands of
+ * the books are taken as if they succeed when their parameters are
+ * valid.
+ * @param fileName
+ */
+inline std::vector<Operation> recordTrace(const std::string& fileName)
+{
+    std::vector<Operation> trace;
+    std::map<std::string, offset_t> books; // the ISBNs and their values
+    std::map<std::string, std::set<std::string>> keywords; // of the books
+    std::string selected, line;
+    std::ifstream commands(fileName);
+    auto valueOf = [](const std::string& parameter, size_t prefixLength) {
+        std::string value = parameter.substr(prefixLength);
+        if (value.size() >= 2 && value.front() == '"') value = value.substr(1, value.size() - 2);
+        return value;
+    };
+
+    while (std::getline(commands, line)) {
+        std::istringstream tokens(line);
+        std::string command, parameter;
+        tokens >> command;
+        if (command == "select" && tokens >> parameter) {
+            trace.push_back(Operation{Operation::get, false, "", parameter, 0});
+            if (books.count(parameter) == 0) {
+                const offset_t value = static_cast<offset_t>(books.size());
+                books[parameter] = value;
+                trace.push_back(Operation{Operation::insert, false, "", parameter, value});
+            }
+            selected = parameter;
+        } else if (command == "buy" && tokens >> parameter) {
+            trace.push_back(Operation{Operation::get, false, "", parameter, 0});
+        } else if (command == "show" && tokens >> parameter) {
+            if (parameter.rfind("-ISBN=", 0) == 0) {
+                trace.push_back(Operation{Operation::get, false, "", valueOf(parameter, 6), 0});
+            } else if (parameter.rfind("-keyword=", 0) == 0) {
+                trace.push_back(Operation{Operation::scan, true, valueOf(parameter, 9), "", 0});
+            }
+        } else if (command == "modify" && !selected.empty()) {
+            while (tokens >> parameter) {
+                const offset_t value = books[selected];
+                std::set<std::string>& words = keywords[selected];
+                if (parameter.rfind("-ISBN=", 0) == 0) {
+                    const std::string isbn = valueOf(parameter, 6);
+                    trace.push_back(Operation{Operation::get, false, "", isbn, 0});
+                    if (books.count(isbn) != 0) break; // (an invalid command)
+                    trace.push_back(Operation{Operation::erase, false, "", selected, 0});
+                    trace.push_back(Operation{Operation::insert, false, "", isbn, value});
+                    for (const std::string& word : words) {
+                        trace.push_back(Operation{Operation::erase, true, word, selected, 0});
+                        trace.push_back(Operation{Operation::insert, true, word, isbn, value});
+                    }
+                    books.erase(selected);
+                    books[isbn] = value;
+                    keywords[isbn] = words;
+                    keywords.erase(selected);
+                    selected = isbn;
+                } else if (parameter.rfind("-keyword=", 0) == 0) {
+                    for (const std::string& word : words) {
+                        trace.push_back(Operation{Operation::erase, true, word, selected, 0});
+                    }
+                    words.clear();
+                    std::istringstream newWords(valueOf(parameter, 9));
+                    std::string word;
+                    while (std::getline(newWords, word, '|')) {
+                        if (!word.empty() && words.insert(word).second) {
+                            trace.push_back(Operation{Operation::insert, true, word, selected, value});
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return trace;
+}
+
+/**
+ * This function returns the traces to replay: the ones recorded from
+ * the files of commands given in the arguments, or a generated one if
+ * no file is given.
+ * @param argc
+ * @param argv
+ * @param first the index of the first argument that is a file
+ * @return the names and the traces
+ */
+inline std::vector<std::pair<std::string, std::vector<Operation>>> loadTraces(int argc, char** argv, int first = 1)
+{
+    std::vector<std::pair<std::string, std::vector<Operation>>> traces;
+    for (int i = first; i < argc; ++i) traces.emplace_back(argv[i], recordTrace(argv[i]));
+    if (traces.empty()) traces.emplace_back("generated", generateTrace(200000));
+    return traces;
+}
+
+/**
+ * @class ScratchContainer
+ *
+ * This is a new container in the working directory for a run of a
+ * benchmark, which is removed when the run ends.
+ * <br><br>
+ * WARNING: the indexes in it MUST be destroyed before it.
+ */
+class ScratchContainer {
+private:
+    std::string _file_name;
+
+public:
+    explicit ScratchContainer(std::string fileName = "benchmark_database") : _file_name(std::move(fileName))
+    {
+        std::remove(_file_name.c_str());
+        Container::instance().open(_file_name);
+    }
+
+    ~ScratchContainer()
+    {
+        Container::instance().close();
+        std::remove(_file_name.c_str());
+    }
+};
+
+/**
+ * @struct Timing{count, nanoseconds}
+ *
+ * This is the total time of the operations of a type.
+ */
+struct Timing {
+    long count = 0;
+
+    double nanoseconds = 0;
+
+    [[nodiscard]] double average() const
+    {
+        return (count == 0) ? 0 : nanoseconds / count;
+    }
+};
+
+/**
+ * This function replays a trace on an index of the ISBNs and an index
+ * of the keywords, and times each type of the operations.
+ * @tparam isbnIndex an index from BenchmarkISBN to offset_t
+ * @tparam keywordIndex an index from (BenchmarkKeyword, BenchmarkISBN) to offset_t
+ * @param trace
+ * @param isbns
+ * @param keywords
+ * @param checksum the place to put a checksum of the results of the lookups
+ * @return the timings by the types of the operations
+ */
+template <class isbnIndex, class keywordIndex>
+std::vector<Timing> replay(const std::vector<Operation>& trace, isbnIndex& isbns, keywordIndex& keywords,
+                           unsigned long& checksum)
+{
+    std::vector<Timing> timings(4);
+    checksum = 0;
+    for (const Operation& operation : trace) {
+        const BenchmarkISBN isbn(operation.isbn);
+        const BenchmarkKeyword keyword(operation.keyword);
+        const auto start = std::chrono::steady_clock::now();
+        switch (operation.type) {
+            case Operation::insert:
+                if (operation.onKeyword) keywords.insert(keyword, isbn, operation.value);
+                else isbns.insert(isbn, operation.value);
+                break;
+            case Operation::erase:
+                if (operation.onKeyword) keywords.erase(keyword, isbn);
+                else isbns.erase(isbn);
+                break;
+            case Operation::get: {
+                std::optional<offset_t> value = operation.onKeyword ? keywords.get(keyword, isbn) : isbns.get(isbn);
+                checksum = checksum * 31 + (value ? *value + 1 : 0);
+                break;
+            }
+            case Operation::scan:
+                for (auto cursor = keywords.cursor(keyword); cursor.hasNext();) {
+                    checksum = checksum * 31 + cursor.next() + 1;
+                }
+                break;
+        }
+        Timing& timing = timings[operation.type];
+        timing.nanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        ++timing.count;
+    }
+    return timings;
+}
+
+/**
+ * This function prints the timings of a run in a row.
+ * @param label
+ * @param timings
+ */
+inline void printTimings(const std::string& label, const std::vector<Timing>& timings)
+{
+    std::printf("%-28s %12.0f %12.0f %12.0f %12.0f\n", label.c_str(), timings[Operation::insert].average(),
+                timings[Operation::erase].average(), timings[Operation::get].average(),
+                timings[Operation::scan].average());
+}
+
+/**
+ * This function prints the head of the table of printTimings.
+ * @param label the name of the first column
+ */
+inline void printTimingHead(const std::string& label)
+{
+    std::printf("%-28s %12s %12s %12s %12s\n", label.c_str(), "insert (ns)", "erase (ns)", "get (ns)", "scan (ns)");
+}
+
+#endif //BENCHMARK
@@ -0,0 +1,59 @@
+// This benchmark replays the same traces on the unrolled linked lists
+// with main nodes of different sizes, from a quarter of a block of the
+// buffer pool to four blocks, and prints the average time of each type
+// of the operations.  A new list takes a block per main node (see
+// CompositeUnrolledLinkedList::targetArraySize).
+//
+// Usage: BlockSizeBenchmark [files of commands...]
+// The traces are taken just like the ones of EngineBenchmark.
+
+#include "../unrolled_linked_list.h"
+#include "benchmark.h"
+
+typedef UnrolledLinkedList<BenchmarkISBN, offset_t> ISBNList;
+
+typedef DoubleUnrolledLinkedList<BenchmarkKeyword, BenchmarkISBN, offset_t> KeywordList;
+
+/**
+ * This function replays a trace on a new pair of lists whose arrays of
+ * the main nodes take about a certain number of bytes.
+ * @param bytes
+ * @param trace
+ * @return the checksum of the results of the lookups
+ */
+unsigned long runNodeSize(long bytes, const std::vector<Operation>& trace)
+{
+    // (the same sizes of the pairs as the ones in the arrays)
+    const int isbnNodeSize = static_cast<int>(bytes / sizeof(std::pair<BenchmarkISBN, offset_t>));
+    const int keywordNodeSize =
+            static_cast<int>(bytes / sizeof(std::pair<std::pair<BenchmarkKeyword, BenchmarkISBN>, offset_t>));
+    ScratchContainer container;
+    ISBNList isbns("benchmark_isbn", isbnNodeSize);
+    KeywordList keywords("benchmark_keyword", keywordNodeSize);
+    unsigned long checksum;
+    std::vector<Timing> timings = replay(trace, isbns, keywords, checksum);
+    printTimings(std::to_string(bytes) + " B (" + std::to_string(isbnNodeSize) + ", " +
+                 std::to_string(keywordNodeSize) + " pairs)", timings);
+    return checksum;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 0;
+    for (const auto& [name, trace] : loadTraces(argc, argv)) {
+        std::cout << name << ": " << trace.size() << " operations, blocks of " << BufferPool::blockSize << " B"
+                  << std::endl;
+        printTimingHead("array of a main node");
+        unsigned long checksum = 0;
+        for (long bytes = BufferPool::blockSize / 4; bytes <= 4 * BufferPool::blockSize; bytes *= 2) {
+            unsigned long sizeChecksum = runNodeSize(bytes, trace);
+            if (bytes != BufferPool::blockSize / 4 && sizeChecksum != checksum) { // they MUST give the same results
+                std::cout << "the results of the sizes are different" << std::endl;
+                result = 1;
+            }
+            checksum = sizeChecksum;
+        }
+        std::cout << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,101 @@
+// This benchmark replays the same traces on both engines of the indexes
+// (the unrolled linked list and the B+ tree), and prints the average
+// time of each type of the operations.  The lookups of the ISBNs are
+// then repeated one by one and in batches (by multiGet).
+//
+// Usage: EngineBenchmark [files of commands...]
+// The operations on the indexes are recorded from the commands in the
+// files (such as the inputs of the tests).  If no file is given, a
+// generated trace is used.
+
+#include <algorithm>
+
+#include "../bplus_tree.h"
+#include "../unrolled_linked_list.h"
+#include "benchmark.h"
+
+// the number of the ISBNs looked up at a time by multiGet
+const size_t batchSize = 256;
+
+/**
+ * This function looks up the ISBNs of the lookups of a trace in the
+ * index left by it, one by one and then in batches with multiGet, and
+ * prints the average time of a lookup in each way.
+ * @tparam isbnIndex
+ * @param trace
+ * @param isbns
+ * @return whether the two ways give the same results
+ */
+template <class isbnIndex>
+bool compareBatches(const std::vector<Operation>& trace, isbnIndex& isbns)
+{
+    std::vector<BenchmarkISBN> keys;
+    for (const Operation& operation : trace) {
+        if (operation.type == Operation::get && !operation.onKeyword) keys.emplace_back(operation.isbn);
+    }
+    if (keys.empty()) return true;
+
+    std::vector<std::optional<offset_t>> single, batched;
+    auto start = std::chrono::steady_clock::now();
+    for (const BenchmarkISBN& key : keys) single.push_back(isbns.get(key));
+    const double singleTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (size_t begin = 0; begin < keys.size(); begin += batchSize) {
+        std::vector<BenchmarkISBN> batch(keys.begin() + begin, keys.begin() + std::min(begin + batchSize, keys.size()));
+        for (const std::optional<offset_t>& value : isbns.multiGet(batch)) batched.push_back(value);
+    }
+    const double batchedTime = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%-28s %12.0f %12.0f\n", "  get one by one / batched", singleTime / keys.size(),
+                batchedTime / keys.size());
+    return single == batched;
+}
+
+/**
+ * This function replays a trace on a new pair of indexes of an engine.
+ * @tparam isbnIndex
+ * @tparam keywordIndex
+ * @param label
+ * @param trace
+ * @param consistent set to false if multiGet disagrees with get
+ * @return the checksum of the results of the lookups
+ */
+template <class isbnIndex, class keywordIndex>
+unsigned long runEngine(const std::string& label, const std::vector<Operation>& trace, bool& consistent)
+{
+    ScratchContainer container;
+    isbnIndex isbns("benchmark_isbn");
+    keywordIndex keywords("benchmark_keyword");
+    unsigned long checksum;
+    printTimings(label, replay(trace, isbns, keywords, checksum));
+    if (!compareBatches(trace, isbns)) consistent = false;
+    return checksum;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 0;
+    for (const auto& [name, trace] : loadTraces(argc, argv)) {
+        std::cout << name << ": " << trace.size() << " operations" << std::endl;
+        printTimingHead("engine");
+        bool consistent = true;
+        unsigned long listChecksum =
+                runEngine<UnrolledLinkedList<BenchmarkISBN, offset_t>,
+                          DoubleUnrolledLinkedList<BenchmarkKeyword, BenchmarkISBN, offset_t>>("unrolled linked list",
+                                                                                             trace, consistent);
+        unsigned long treeChecksum =
+                runEngine<BPlusTree<BenchmarkISBN, offset_t>,
+                          DoubleBPlusTree<BenchmarkKeyword, BenchmarkISBN, offset_t>>("B+ tree", trace, consistent);
+        if (listChecksum != treeChecksum) { // the engines MUST give the same results
+            std::cout << "the results of the engines are different" << std::endl;
+            result = 1;
+        }
+        if (!consistent) {
+            std::cout << "the results of multiGet are different from those of get" << std::endl;
+            result = 1;
+        }
+        std::cout << std::endl;
+    }
+    return result;
+}
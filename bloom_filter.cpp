@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include "bloom_filter.h"
+
+std::uint64_t BloomFilter::_bit(std::uint64_t hash, int i) const
+{
+    std::uint64_t step = (hash >> 33 | hash << 31) | 1;
+    return (hash + i * step) % _head.bitCount;
+}
+
+BloomFilter::BloomFilter(const std::string& fileName) : _file(fileName), _head{0, 0}
+{
+    if (_file.size() < static_cast<offset_t>(sizeof(_header))) return;
+    _file.read(0, reinterpret_cast<char*>(&_head), sizeof(_header));
+    _bits.resize(_head.bitCount / 8);
+    if (_file.size() < static_cast<offset_t>(sizeof(_header) + _bits.size())) { // a broken file
+        _head = _header{0, 0};
+        _bits.clear();
+        return;
+    }
+    _file.read(sizeof(_header), reinterpret_cast<char*>(_bits.data()), static_cast<offset_t>(_bits.size()));
+}
+
+BloomFilter::~BloomFilter()
+{
+    if (_head_dirty) _file.write(0, reinterpret_cast<char*>(&_head), sizeof(_header));
+}
+
+bool BloomFilter::built() const
+{
+    return _head.bitCount != 0;
+}
+
+bool BloomFilter::full() const
+{
+    return _head.keyCount * bitsPerKey > _head.bitCount;
+}
+
+bool BloomFilter::mayContain(std::uint64_t hash) const
+{
+    if (!built()) return true;
+    for (int i = 0; i < hashCount; ++i) {
+        std::uint64_t bit = _bit(hash, i);
+        if (!(_bits[bit / 8] & (1 << (bit % 8)))) return false;
+    }
+    return true;
+}
+
+void BloomFilter::add(std::uint64_t hash)
+{
+    for (int i = 0; i < hashCount; ++i) {
+        std::uint64_t bit = _bit(hash, i);
+        unsigned char& byte = _bits[bit / 8];
+        if (byte & (1 << (bit % 8))) continue;
+        byte |= static_cast<unsigned char>(1 << (bit % 8));
+        _file.write(static_cast<offset_t>(sizeof(_header) + bit / 8), reinterpret_cast<char*>(&byte), 1);
+    }
+    ++_head.keyCount;
+    _head_dirty = true;
+}
+
+void BloomFilter::reset(const std::vector<std::uint64_t>& hashes)
+{
+    _head.bitCount = std::max<std::uint64_t>(2 * hashes.size(), minCapacity) * bitsPerKey / 8 * 8;
+    _head.keyCount = hashes.size();
+    _bits.assign(_head.bitCount / 8, 0);
+    for (std::uint64_t hash : hashes) {
+        for (int i = 0; i < hashCount; ++i) {
+            std::uint64_t bit = _bit(hash, i);
+            _bits[bit / 8] |= static_cast<unsigned char>(1 << (bit % 8));
+        }
+    }
+    _file.resize(0);
+    _file.write(0, reinterpret_cast<char*>(&_head), sizeof(_header));
+    _head_dirty = false;
+    _file.write(sizeof(_header), reinterpret_cast<char*>(_bits.data()), static_cast<offset_t>(_bits.size()));
+}
+
+void BloomFilter::flush()
+{
+    if (_head_dirty) {
+        _file.write(0, reinterpret_cast<char*>(&_head), sizeof(_header));
+        _head_dirty = false;
+    }
+    _file.flush();
+}
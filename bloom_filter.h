@@ -0,0 +1,112 @@
+#ifndef BLOOM_FILTER
+#define BLOOM_FILTER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "storage_file.h"
+
+/**
+ * This function returns the hash of a key for the Bloom filters.  Only
+ * the bytes before the first zero are used, as the keys are strings
+ * ended by '\0' whose rest may be anything.
+ * @param key
+ * @return the hash
+ */
+template <class keyType>
+std::uint64_t keyHash(const keyType& key)
+{
+    const char* bytes = reinterpret_cast<const char*>(&key);
+    std::uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+    for (size_t i = 0; i < sizeof(keyType) && bytes[i] != '\0'; ++i) {
+        hash ^= static_cast<unsigned char>(bytes[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @class BloomFilter
+ *
+ * This is a Bloom filter kept in a file beside an index.  It tells
+ * whether a key may be in the index without reading the index, and a
+ * key that is not added is almost always reported as absent.  The bits
+ * are kept in the memory, and the changed ones are written back through
+ * the storage file, so they are committed together with the index.
+ * <br><br>
+ * The keys are never removed from the filter, so it has to be reset
+ * with the keys of the index once it holds more keys than its capacity.
+ */
+class BloomFilter {
+public:
+    static constexpr int bitsPerKey = 10;
+
+    static constexpr int hashCount = 7;
+
+    static constexpr std::uint64_t minCapacity = 4096; // the number of keys for the smallest filter
+
+private:
+    StorageFile _file;
+
+    /**
+     * @struct _header{bitCount, keyCount}
+     *
+     * This is the metadata at the head of the file.
+     */
+    struct _header {
+        std::uint64_t bitCount; // 0 for a filter that has not been built
+
+        std::uint64_t keyCount; // the number of keys added since the last reset
+    } _head;
+
+    bool _head_dirty = false; // whether the header has been changed since it was written
+
+    std::vector<unsigned char> _bits;
+
+    /**
+     * This function returns the i-th bit of a hash (by double hashing).
+     */
+    [[nodiscard]] std::uint64_t _bit(std::uint64_t hash, int i) const;
+
+public:
+    explicit BloomFilter(const std::string& fileName);
+
+    ~BloomFilter();
+
+    /**
+     * This function tells whether the filter has been built.  A filter
+     * whose file is new has to be reset with the keys of the index.
+     */
+    [[nodiscard]] bool built() const;
+
+    /**
+     * This function tells whether the filter holds more keys than its
+     * capacity, in which case it should be reset with a larger capacity.
+     */
+    [[nodiscard]] bool full() const;
+
+    /**
+     * This function tells whether a key may have been added.
+     * @param hash the hash of the key
+     * @return false if the key has not been added
+     */
+    [[nodiscard]] bool mayContain(std::uint64_t hash) const;
+
+    /**
+     * This function adds a key.
+     * @param hash the hash of the key
+     */
+    void add(std::uint64_t hash);
+
+    /**
+     * This function replaces all the keys with the given ones, and makes
+     * the filter for twice as many keys (no less than minCapacity).
+     * @param hashes the hashes of the keys
+     */
+    void reset(const std::vector<std::uint64_t>& hashes);
+
+    void flush();
+};
+
+#endif //BLOOM_FILTER
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <iomanip>
 #include <set>
+#include <vector>
 
 #include "book.h"
 #include "account.h"
@@ -162,27 +164,143 @@ std::ostream& operator<<(std::ostream& os, const Book& book)
 
 BookGroup::BookGroup()
 {
-    std::ifstream tester("book");
-    if (tester.good()) { // such file exists
-        tester.close();
-        _books.open("book");
-    } else { // no such file
-        tester.close();
+    if (_secondary_stale) _build_secondary_indexes();
+#ifdef BOOKSTORE_CATALOG
+    if (_catalog_missing) _build_catalog();
+    _catalog.setBufferCapacity(_index_buffer_size);
+#else
+    // (a catalog left by a build with the catalog misses the changes since then)
+    for (const char* suffix : {"", "_buffer", "_bloom"}) {
+        Container::instance().remove(std::string("book_catalog") + suffix);
+    }
+#endif
 
-        // create file "book"
-        std::ofstream fileCreator("book");
-        fileCreator.close();
+    // (the indexes are changed by many select and modify commands in a row)
+    _isbn_book_map.setBufferCapacity(_index_buffer_size);
+    _name_book_map.setBufferCapacity(_index_buffer_size);
+    _author_book_map.setBufferCapacity(_index_buffer_size);
+    _keywords_book_map.setBufferCapacity(_index_buffer_size);
+}
 
-        // open the file with _book
-        _books.open("book");
+bool BookGroup::_secondary_indexes_stale()
+{
+    Container& container = Container::instance();
+    bool stale = !container.exists(std::string("book_index_name") + _secondary_suffix);
+    for (const char* index : {"book_index_name", "book_index_author", "book_index_keyword"}) {
+        std::string fileName = std::string(index) + _other_secondary_suffix;
+        if (!container.exists(fileName)) continue;
+        stale = true;
+        container.remove(fileName);
+        container.remove(fileName + "_buffer");
     }
+    return stale;
 }
 
-Book BookGroup::find(int offset)
+void BookGroup::_build_secondary_indexes()
 {
-    _books.seekg(offset);
+    std::vector<std::tuple<Name, ISBN, secondaryEntry>> names;
+    std::vector<std::tuple<Author, ISBN, secondaryEntry>> authors;
+    std::vector<std::tuple<Keyword, ISBN, secondaryEntry>> keywords;
     Book book;
-    _books.read(reinterpret_cast<char*>(&book), sizeof(Book));
+    for (offset_t offset = 0; offset + static_cast<offset_t>(sizeof(Book)) <= _books.size(); offset += sizeof(Book)) {
+        _books.read(offset, reinterpret_cast<char*>(&book), sizeof(Book));
+        secondaryEntry entry = _secondary_entry(book, offset);
+        if (book.name.name[0] != '\0') names.emplace_back(book.name, book.isbn, entry);
+        if (book.author.author[0] != '\0') authors.emplace_back(book.author, book.isbn, entry);
+        if (book.keywords.keywords[0] != '\0') {
+            TokenScanner keywordSeparator(string_t(book.keywords.keywords), '|', TokenScanner::single);
+            while (keywordSeparator.hasMoreToken()) {
+                keywords.emplace_back(Keyword(keywordSeparator.nextToken()), book.isbn, entry);
+            }
+        }
+    }
+
+    // (the values are not compared, as the key pairs are distinct)
+    auto byKeys = [](const auto& lhs, const auto& rhs) {
+        return std::get<0>(lhs) < std::get<0>(rhs) ||
+               (std::get<0>(lhs) == std::get<0>(rhs) && std::get<1>(lhs) < std::get<1>(rhs));
+    };
+    std::sort(names.begin(), names.end(), byKeys);
+    std::sort(authors.begin(), authors.end(), byKeys);
+    std::sort(keywords.begin(), keywords.end(), byKeys);
+    _name_book_map.bulkLoad(names.begin(), names.end());
+    _author_book_map.bulkLoad(authors.begin(), authors.end());
+    _keywords_book_map.bulkLoad(keywords.begin(), keywords.end());
+}
+
+#ifdef BOOKSTORE_CATALOG
+void BookGroup::_build_catalog()
+{
+    std::vector<std::pair<ISBN, Book>> pairs;
+    Book book;
+    for (offset_t offset = 0; offset + static_cast<offset_t>(sizeof(Book)) <= _books.size(); offset += sizeof(Book)) {
+        _books.read(offset, reinterpret_cast<char*>(&book), sizeof(Book));
+        pairs.emplace_back(book.isbn, book);
+    }
+    std::sort(pairs.begin(), pairs.end(),
+              [](const std::pair<ISBN, Book>& lhs, const std::pair<ISBN, Book>& rhs) { return lhs.first < rhs.first; });
+    _catalog.bulkLoad(pairs.begin(), pairs.end());
+}
+#endif
+
+secondaryEntry BookGroup::_secondary_entry([[maybe_unused]] const Book& book, [[maybe_unused]] offset_t offset)
+{
+#ifdef BOOKSTORE_COVERING_INDEX
+    return book;
+#else
+    return offset;
+#endif
+}
+
+void BookGroup::_cache_book(offset_t offset, const Book& book)
+{
+    bool inserted;
+    _book_cache.value(_book_cache.put(offset, inserted)) = book;
+}
+
+void BookGroup::_write_book(offset_t offset, const Book& book, bool newBook)
+{
+    _books.write(offset, reinterpret_cast<const char*>(&book), sizeof(Book));
+    _cache_book(offset, book);
+    if (newBook) return;
+#ifdef BOOKSTORE_CATALOG
+    _catalog.modify(book.isbn, book);
+#endif
+#ifdef BOOKSTORE_COVERING_INDEX
+    if (book.name.name[0] != '\0') _name_book_map.modify(book.name, book.isbn, book);
+    if (book.author.author[0] != '\0') _author_book_map.modify(book.author, book.isbn, book);
+    if (book.keywords.keywords[0] != '\0') {
+        TokenScanner keywordSeparator(string_t(book.keywords.keywords), '|', TokenScanner::single);
+        while (keywordSeparator.hasMoreToken()) {
+            _keywords_book_map.modify(Keyword(keywordSeparator.nextToken()), book.isbn, book);
+        }
+    }
+#endif
+}
+
+Book BookGroup::_book_of(offset_t offset)
+{
+    // (a show goes through many books once, so they are not put into the cache)
+    Book book;
+    _books.read(offset, reinterpret_cast<char*>(&book), sizeof(Book));
+    return book;
+}
+
+const Book& BookGroup::_book_of(const Book& book)
+{
+    return book;
+}
+
+Book BookGroup::find(offset_t offset)
+{
+    const int slot = _book_cache.find(offset);
+    if (slot != LRUCache<offset_t, Book>::none) {
+        _book_cache.touch(slot);
+        return _book_cache.value(slot);
+    }
+    Book book;
+    _books.read(offset, reinterpret_cast<char*>(&book), sizeof(Book));
+    _cache_book(offset, book);
     return book;
 }
 
@@ -196,54 +314,54 @@ void BookGroup::show(TokenScanner& line, const LoggingSituation& loggingStatus,
 
     if (loggingStatus.empty()) throw InvalidCommand("Invalid");
 
-    std::vector<int> books;
     if (!line.hasMoreToken()) {
-        books = _isbn_book_map.traverse();
-    } else {
-        string_t parameter = line.nextToken();
-        if (line.hasMoreToken()) throw InvalidCommand("Invalid");
+#ifdef BOOKSTORE_CATALOG
+        _print_books(_catalog.cursor());
+#else
+        _print_books(_isbn_book_map.cursor());
+#endif
+        return;
+    }
 
-        BookParameter bookParameter = processParameter(parameter);
+    string_t parameter = line.nextToken();
+    if (line.hasMoreToken()) throw InvalidCommand("Invalid");
 
-        if (bookParameter.type == isbn) {
-            int* offset = _isbn_book_map.get(ISBN(bookParameter.content));
+    BookParameter bookParameter = processParameter(parameter);
 
-            if (offset == nullptr) {
-                std::cout << 0 << std::endl;
-                return;
-            } else {
-                books.push_back(*offset);
-                delete offset;
-            }
+    if (bookParameter.type == isbn) {
+        std::optional<offset_t> offset = _isbn_book_map.get(ISBN(bookParameter.content));
 
-        } else if (bookParameter.type == name) {
-            books = _name_book_map.traverse(Name(bookParameter.content));
+        if (!offset) {
+            std::cout << 0 << std::endl;
+        } else {
+            std::cout << 1 << std::endl << find(*offset) << std::endl;
+        }
 
-        } else if (bookParameter.type == author) {
-            books = _author_book_map.traverse(Author(bookParameter.content));
+    } else if (bookParameter.type == name) {
+        _print_books(_name_book_map.cursor(Name(bookParameter.content)));
 
-        } else if (bookParameter.type == keywords) {
-            for (char_t c : bookParameter.content) {
-                if (c == '|') throw InvalidCommand("Invalid");
-            }
-            books = _keywords_book_map.traverse(Keyword(bookParameter.content));
-        } else {
-            throw InvalidCommand("Invalid");
+    } else if (bookParameter.type == author) {
+        _print_books(_author_book_map.cursor(Author(bookParameter.content)));
+
+    } else if (bookParameter.type == keywords) {
+        for (char_t c : bookParameter.content) {
+            if (c == '|') throw InvalidCommand("Invalid");
         }
+        _print_books(_keywords_book_map.cursor(Keyword(bookParameter.content)));
+    } else {
+        throw InvalidCommand("Invalid");
     }
+}
 
-    if (books.empty()) {
-        std::cout << 0 << std::endl;
-        return;
-    }
+template <class cursorType>
+void BookGroup::_print_books(cursorType cursor)
+{
+    // Count the books first with a copy of the cursor
+    long count = 0;
+    for (cursorType counter = cursor; counter.hasNext(); counter.next()) ++count;
+    std::cout << count << std::endl;
 
-    Book tmp;
-    std::cout << books.size() << std::endl;
-    for (int offset : books) {
-        _books.seekg(offset);
-        _books.read(reinterpret_cast<char*>(&tmp), sizeof(Book));
-        std::cout << tmp << std::endl;
-    }
+    while (cursor.hasNext()) std::cout << _book_of(cursor.next()) << std::endl;
 }
 
 void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus, LogGroup& logGroup)
@@ -265,11 +383,7 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
         if (toModify.back().type == isbn) {
             if (existISBN) throw InvalidCommand("Invalid");
             else {
-                int* offset = _isbn_book_map.get(ISBN(toModify.back().content));
-                if (offset != nullptr) {
-                    delete offset;
-                    throw InvalidCommand("Invalid");
-                }
+                if (_isbn_book_map.get(ISBN(toModify.back().content))) throw InvalidCommand("Invalid");
                 existISBN = true;
             }
         } else if (toModify.back().type == name) {
@@ -288,9 +402,7 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
     }
 
     // get book first
-    Book bookToModify;
-    _books.seekg(loggingStatus.getSelected());
-    _books.read(reinterpret_cast<char*>(&bookToModify), sizeof(Book));
+    Book bookToModify = find(loggingStatus.getSelected());
 
     // modify the data
     for (const BookParameter& bookParameter: toModify) {
@@ -309,29 +421,38 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
             // ISBN
             _isbn_book_map.erase(bookToModify.isbn);
             _isbn_book_map.insert(newISBN, loggingStatus.getSelected());
+#ifdef BOOKSTORE_CATALOG
+            _catalog.erase(bookToModify.isbn);
+            _catalog.insert(newISBN, bookToModify);
+#endif
 
             // book name
             if (bookToModify.name.name[0] != '\0') {
                 _name_book_map.erase(bookToModify.name, bookToModify.isbn);
-                _name_book_map.insert(bookToModify.name, newISBN, loggingStatus.getSelected());
+                _name_book_map.insert(bookToModify.name, newISBN,
+                                      _secondary_entry(bookToModify, loggingStatus.getSelected()));
             }
 
             // author
             if (bookToModify.author.author[0] != '\0') {
                 _author_book_map.erase(bookToModify.author, bookToModify.isbn);
-                _author_book_map.insert(bookToModify.author, newISBN, loggingStatus.getSelected());
+                _author_book_map.insert(bookToModify.author, newISBN,
+                                        _secondary_entry(bookToModify, loggingStatus.getSelected()));
             }
 
             // keywords
             if (bookToModify.keywords.keywords[0] != '\0') {
                 TokenScanner keywordSeparator(string_t(bookToModify.keywords.keywords),
                                               '|', TokenScanner::single);
-                Keyword keywordBuffer;
+                std::vector<std::pair<Keyword, ISBN>> oldKeys;
+                std::vector<std::tuple<Keyword, ISBN, secondaryEntry>> newKeys;
                 while (keywordSeparator.hasMoreToken()) {
-                    keywordBuffer = Keyword(keywordSeparator.nextToken());
-                    _keywords_book_map.erase(keywordBuffer, bookToModify.isbn);
-                    _keywords_book_map.insert(keywordBuffer, newISBN, loggingStatus.getSelected());
+                    Keyword keyword(keywordSeparator.nextToken());
+                    oldKeys.emplace_back(keyword, bookToModify.isbn);
+                    newKeys.emplace_back(keyword, newISBN, _secondary_entry(bookToModify, loggingStatus.getSelected()));
                 }
+                _keywords_book_map.multiErase(oldKeys);
+                _keywords_book_map.multiInsert(newKeys);
             }
 
             bookToModify.isbn = newISBN;
@@ -355,7 +476,8 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
             if (bookToModify.name.name[0] != '\0') {
                 _name_book_map.erase(bookToModify.name, bookToModify.isbn);
             }
-            _name_book_map.insert(newName, bookToModify.isbn, loggingStatus.getSelected());
+            _name_book_map.insert(newName, bookToModify.isbn,
+                                  _secondary_entry(bookToModify, loggingStatus.getSelected()));
 
             bookToModify.name = newName;
 
@@ -378,7 +500,8 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
             if (bookToModify.author.author[0] != '\0') {
                 _author_book_map.erase(bookToModify.author, bookToModify.isbn);
             }
-            _author_book_map.insert(newAuthor, bookToModify.isbn, loggingStatus.getSelected());
+            _author_book_map.insert(newAuthor, bookToModify.isbn,
+                                    _secondary_entry(bookToModify, loggingStatus.getSelected()));
 
             bookToModify.author = newAuthor;
 
@@ -400,21 +523,23 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
             if (bookToModify.keywords.keywords[0] != '\0') {
                 TokenScanner keywordSeparator(string_t(bookToModify.keywords.keywords),
                                               '|', TokenScanner::single);
-                Keyword keywordBuffer;
+                std::vector<std::pair<Keyword, ISBN>> oldKeys;
                 while (keywordSeparator.hasMoreToken()) {
-                    keywordBuffer = Keyword(keywordSeparator.nextToken());
-                    _keywords_book_map.erase(keywordBuffer, bookToModify.isbn);
+                    oldKeys.emplace_back(Keyword(keywordSeparator.nextToken()), bookToModify.isbn);
                 }
+                _keywords_book_map.multiErase(oldKeys);
             }
 
             // add new keywords
             bookToModify.keywords = Keywords(bookParameter.content);
             TokenScanner newKeywordSeparator(bookParameter.content,
                                              '|', TokenScanner::single);
+            std::vector<std::tuple<Keyword, ISBN, secondaryEntry>> newKeys;
             while (newKeywordSeparator.hasMoreToken()) {
-                _keywords_book_map.insert(Keyword(newKeywordSeparator.nextToken()),
-                                          bookToModify.isbn, loggingStatus.getSelected());
+                newKeys.emplace_back(Keyword(newKeywordSeparator.nextToken()),
+                                     bookToModify.isbn, _secondary_entry(bookToModify, loggingStatus.getSelected()));
             }
+            _keywords_book_map.multiInsert(newKeys);
 
         } else if (bookParameter.type == price) {
             // add a log
@@ -434,9 +559,8 @@ void BookGroup::modify(TokenScanner& line, const LoggingSituation& loggingStatus
             bookToModify.price = newPrice;
         }
 
-        // Put the book back
-        _books.seekp(loggingStatus.getSelected());
-        _books.write(reinterpret_cast<const char*>(&bookToModify), sizeof(Book));
+        // Put the book back (and the copies of it in the secondary indexes)
+        _write_book(loggingStatus.getSelected(), bookToModify);
 
         std::cout << "Success" << std::endl;
     }
@@ -450,39 +574,24 @@ void BookGroup::buy(TokenScanner& line, const LoggingSituation& loggingStatus, L
     if (!line.hasMoreToken()) throw InvalidCommand("Invalid");
     string_t ISBNString = line.nextToken();
     if (!validISBN(ISBNString)) throw InvalidCommand("Invalid");
-    int* offset = _isbn_book_map.get(ISBN(ISBNString));
-    if (offset == nullptr) throw InvalidCommand("Invalid");
+    std::optional<offset_t> offset = _isbn_book_map.get(ISBN(ISBNString));
+    if (!offset) throw InvalidCommand("Invalid");
 
     // read the quantity
-    if (!line.hasMoreToken()) {
-        delete offset;
-        throw InvalidCommand("Invalid");
-    }
+    if (!line.hasMoreToken()) throw InvalidCommand("Invalid");
     string_t quantityString = line.nextToken();
-    if (line.hasMoreToken()) {
-        delete offset;
-        throw InvalidCommand("Invalid");
-    }
+    if (line.hasMoreToken()) throw InvalidCommand("Invalid");
     for (char_t c : quantityString) {
-        if (c < 48 || c > 57) {
-            delete offset;
-            throw InvalidCommand("Invalid");
-        }
+        if (c < 48 || c > 57) throw InvalidCommand("Invalid");
     }
     int quantity = stringToInt(quantityString);
 
     // read the book data
-    Book book;
-    _books.seekg(*offset);
-    _books.read(reinterpret_cast<char*>(&book), sizeof(Book));
-    if (quantity > book.quantity) {
-        delete offset;
-        throw InvalidCommand("Invalid");
-    }
+    Book book = find(*offset);
+    if (quantity > book.quantity) throw InvalidCommand("Invalid");
     book.quantity -= quantity;
     std::cout << std::fixed << std::setprecision(2) << quantity * book.price << std::endl;
-    _books.seekp(*offset);
-    _books.write(reinterpret_cast<const char*>(&book), sizeof(Book));
+    _write_book(*offset, book);
 
     // add logs
     Log log(Log::buy, quantity * book.price, quantity, true,
@@ -491,7 +600,6 @@ void BookGroup::buy(TokenScanner& line, const LoggingSituation& loggingStatus, L
     logGroup.addLog(log);
     FinanceLog financeLog{quantity * book.price, true};
     logGroup.addFinanceLog(financeLog);
-    delete offset;
 }
 
 void BookGroup::importBook(TokenScanner& line, const LoggingSituation& loggingStatus, LogGroup& logGroup)
@@ -512,12 +620,9 @@ void BookGroup::importBook(TokenScanner& line, const LoggingSituation& loggingSt
     double totalCost = stringToDouble(totalCostString);
 
     // read the book data
-    Book book;
-    _books.seekg(loggingStatus.getSelected());
-    _books.read(reinterpret_cast<char*>(&book), sizeof(Book));
+    Book book = find(loggingStatus.getSelected());
     book.quantity += quantity;
-    _books.seekp(loggingStatus.getSelected());
-    _books.write(reinterpret_cast<const char*>(&book), sizeof(Book));
+    _write_book(loggingStatus.getSelected(), book);
 
     // add logs
     Log log(Log::import, totalCost, quantity, false,
@@ -539,21 +644,23 @@ void BookGroup::select(TokenScanner& line, LoggingSituation& loggingStatus, LogG
     string_t ISBNString = line.nextToken();
     if (line.hasMoreToken() || !validISBN(ISBNString)) throw InvalidCommand("Invalid");
     ISBN isbn(ISBNString);
-    int* offsetPtr = _isbn_book_map.get(isbn);
-    int offset;
-    if (offsetPtr == nullptr) { // no such book
-        _books.seekp(0, std::ios::end);
-        offset = _books.tellp();
+    std::optional<offset_t> offsetFound = _isbn_book_map.get(isbn);
+    offset_t offset;
+    if (!offsetFound) { // no such book
+        offset = _books.size();
         _isbn_book_map.insert(isbn, offset);
         Book book(ISBNString);
-        _books.write(reinterpret_cast<const char*>(&book), sizeof(Book));
+        _write_book(offset, book, true);
+#ifdef BOOKSTORE_CATALOG
+        _catalog.insert(isbn, book);
+#endif
 
         Log log(Log::create, 0, 0, true,
                 UserID(loggingStatus.getID()), offset,
                 string_t(), loggingStatus.getPriority());
         logGroup.addLog(log);
     } else {
-        offset = *offsetPtr;
+        offset = *offsetFound;
     }
 
     loggingStatus.select(offset);
@@ -565,6 +672,9 @@ void BookGroup::flush()
 {
     _books.flush();
     _isbn_book_map.flush();
+#ifdef BOOKSTORE_CATALOG
+    _catalog.flush();
+#endif
     _author_book_map.flush();
     _keywords_book_map.flush();
     _name_book_map.flush();
@@ -693,4 +803,4 @@ BookParameter processParameter(const string_t& token)
     } else {
         throw InvalidCommand("Invalid");
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
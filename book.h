@@ -3,8 +3,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <utility>
 
-#include "unrolled_linked_list.h"
+#include "lru_cache.h"
+#include "storage_engine.h"
 #include "token_scanner.h"
 
 class LoggingSituation;
@@ -94,35 +96,155 @@ struct Book {
     friend std::ostream& operator<<(std::ostream& os, const Book& book);
 };
 
+// The indexes of the names, the authors and the keywords keep the offsets
+// of the books by default.  Define BOOKSTORE_COVERING_INDEX to keep a copy
+// of the whole book in them instead, so that a show with a parameter only
+// scans an index.  The two kinds are kept in different files, and the
+// indexes are built again from the books when the other kind was used
+// last time.
+
+#ifdef BOOKSTORE_COVERING_INDEX
+
+typedef Book secondaryEntry;
+
+#else
+
+typedef offset_t secondaryEntry;
+
+#endif
+
+// Define BOOKSTORE_CATALOG to keep a copy of all the books in the order of
+// the ISBNs as well, so that a show without parameters reads the copy in
+// order instead of reading the books one by one from all over the file of
+// the books.
+
 class BookGroup {
 private:
-    UnrolledLinkedList<ISBN, int> _isbn_book_map
-    = UnrolledLinkedList<ISBN, int>("book_index_ISBN");
+    static constexpr size_t _index_buffer_size = 1024; // the number of writes buffered by each index
+
+#ifdef BOOKSTORE_COVERING_INDEX
+    static constexpr const char* _secondary_suffix = "_covering"; // the suffix of the files of the secondary indexes
+
+    static constexpr const char* _other_secondary_suffix = "";
+#else
+    static constexpr const char* _secondary_suffix = "";
+
+    static constexpr const char* _other_secondary_suffix = "_covering";
+#endif
+
+    Index<ISBN, offset_t> _isbn_book_map
+    = Index<ISBN, offset_t>("book_index_ISBN");
 
-    DoubleUnrolledLinkedList<Name, ISBN, int> _name_book_map
-    = DoubleUnrolledLinkedList<Name, ISBN, int>("book_index_name");
+    // whether the secondary indexes have to be built from the books (checked before they are opened)
+    bool _secondary_stale = _secondary_indexes_stale();
 
-    DoubleUnrolledLinkedList<Author, ISBN, int> _author_book_map
-    = DoubleUnrolledLinkedList<Author, ISBN, int>("book_index_author");
+    DoubleIndex<Name, ISBN, secondaryEntry> _name_book_map
+    = DoubleIndex<Name, ISBN, secondaryEntry>(std::string("book_index_name") + _secondary_suffix);
 
-    DoubleUnrolledLinkedList<Keyword, ISBN, int> _keywords_book_map
-    = DoubleUnrolledLinkedList<Keyword, ISBN, int>("book_index_keyword");
+    DoubleIndex<Author, ISBN, secondaryEntry> _author_book_map
+    = DoubleIndex<Author, ISBN, secondaryEntry>(std::string("book_index_author") + _secondary_suffix);
 
-    std::fstream _books;
+    DoubleIndex<Keyword, ISBN, secondaryEntry> _keywords_book_map
+    = DoubleIndex<Keyword, ISBN, secondaryEntry>(std::string("book_index_keyword") + _secondary_suffix);
+
+#ifdef BOOKSTORE_CATALOG
+    // whether the catalog has to be built from the books (checked before it is opened)
+    bool _catalog_missing = !Container::instance().exists("book_catalog");
+
+    Index<ISBN, Book> _catalog = Index<ISBN, Book>("book_catalog");
+#endif
+
+    StorageFile _books = StorageFile("book");
+
+    static constexpr size_t _book_cache_size = 4096; // the number of books kept in memory
+
+    LRUCache<offset_t, Book> _book_cache = LRUCache<offset_t, Book>(_book_cache_size);
 
     int all_book_num = 0;
 
+    /**
+     * This function puts a book into the cache as the most recently used
+     * one (in place of the old copy of it, if any), and drops the least
+     * recently used one if the cache is full.
+     * @param offset
+     * @param book
+     */
+    void _cache_book(offset_t offset, const Book& book);
+
+    /**
+     * This function tells whether the secondary indexes have to be built
+     * from the books, which is the case if they don't exist, or if the
+     * ones of the other kind exist (so the books may have been changed
+     * without them).  The files of the other kind are removed here.
+     */
+    static bool _secondary_indexes_stale();
+
+    /**
+     * This function builds the secondary indexes from all the books.
+     */
+    void _build_secondary_indexes();
+
+#ifdef BOOKSTORE_CATALOG
+    /**
+     * This function builds the catalog from all the books.
+     */
+    void _build_catalog();
+#endif
+
+    /**
+     * This function returns the value kept in the secondary indexes for
+     * a book.
+     * @param book
+     * @param offset the offset of the book
+     */
+    static secondaryEntry _secondary_entry(const Book& book, offset_t offset);
+
+    /**
+     * This function writes a book back, and changes the copy of it in the
+     * cache.  If the secondary indexes or the catalog keep the books, the
+     * copies in them are changed as well, except for a new book, which is
+     * not in them yet.
+     * <br><br>
+     * WARNING: the entries of the book in the secondary indexes MUST be
+     * of its name, author and keywords, and the one in the catalog MUST
+     * be of its ISBN.
+     * @param offset
+     * @param book
+     * @param newBook whether the book is new (then it MUST be put into the
+     * catalog after that, if there is one)
+     */
+    void _write_book(offset_t offset, const Book& book, bool newBook = false);
+
+    /**
+     * These functions return the book of a value in an index, which is
+     * either the offset of the book or a copy of it.
+     */
+    Book _book_of(offset_t offset);
+
+    static const Book& _book_of(const Book& book);
+
+    /**
+     * This function prints the number of the books given by a cursor,
+     * and then the books one by one without keeping them in memory, so
+     * the index is scanned twice.
+     * @param cursor a cursor over the entries of the books
+     */
+    template <class cursorType>
+    void _print_books(cursorType cursor);
+
 public:
     BookGroup();
 
     ~BookGroup() = default;
 
     /**
-     * This function search a book with ISBN.
+     * This function search a book with ISBN.  The books used recently
+     * are kept in a cache, so a book shown in many lines of a log is read
+     * from the file once.
      * @param offset
      * @return the book data
      */
-    Book find(int offset);
+    Book find(offset_t offset);
 
     /**
      * This function check whether there is a logged-in user first.
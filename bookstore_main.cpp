@@ -8,6 +8,9 @@
 #include "account.h"
 #include "book.h"
 #include "log.h"
+#include "journal.h"
+#include "container.h"
+#include "migration.h"
 
 bool processLine(AccountGroup& accounts, BookGroup& books,
                  LogGroup& logs, LoggingSituation& logInStack);
@@ -16,18 +19,31 @@ void init();
 
 int main()
 {
-    init();
+    try {
+        init();
+    } catch (std::exception& ex) { // the data files cannot be opened by this build
+        std::cerr << ex.what() << std::endl;
+        return 1;
+    }
     AccountGroup accounts;
     BookGroup books;
     LogGroup logs;
     LoggingSituation logInStack;
     while (true) {
         try {
-            if (processLine(accounts, books, logs, logInStack)) return 0;
+            if (processLine(accounts, books, logs, logInStack)) break;
         } catch (std::exception& ex) {
             std::cout << ex.what() << std::endl;
         }
+
+        // write the dirty blocks of this command back and commit them
+        accounts.flush();
+        books.flush();
+        logs.flush();
+        Journal::instance().commit();
     }
+    Journal::instance().close();
+    return 0;
 }
 
 bool processLine(AccountGroup& accounts, BookGroup& books,
@@ -82,38 +98,11 @@ bool processLine(AccountGroup& accounts, BookGroup& books,
 
 void init()
 {
-    std::ifstream tester("account_index");
-    if (!(tester.good())) {
-        std::ofstream creator("account_index");
-        creator.close();
-    }
-    tester.close();
-
-    tester.open("book_index_ISBN");
-    if (!(tester.good())) {
-        std::ofstream creator("book_index_ISBN");
-        creator.close();
-    }
-    tester.close();
+    migrate();
 
-    tester.open("book_index_author");
-    if (!(tester.good())) {
-        std::ofstream creator("book_index_author");
-        creator.close();
-    }
-    tester.close();
-
-    tester.open("book_index_name");
-    if (!(tester.good())) {
-        std::ofstream creator("book_index_name");
-        creator.close();
-    }
-    tester.close();
-
-    tester.open("book_index_keyword");
-    if (!(tester.good())) {
-        std::ofstream creator("book_index_keyword");
-        creator.close();
-    }
-    tester.close();
+#ifndef BOOKSTORE_MMAP
+    // replay the commands committed before the last crash (if any)
+    Journal::instance().open("journal");
+#endif
+    Container::instance().open(Container::defaultName);
 }
@@ -0,0 +1,1140 @@
+#ifndef BPLUS_TREE
+#define BPLUS_TREE
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "composite_key.h"
+#include "fair_shared_mutex.h"
+#include "storage_file.h"
+
+/**
+ * @class BPlusTree
+ *
+ * This is a template class of B+ tree on disk.  Every node of the tree
+ * takes a fixed-size page of the file, and the leaves are linked in
+ * order so that a range can be scanned without going back to the root.
+ * <br><br>
+ * The tree is guarded by a reader-writer lock: any number of threads
+ * can look it up at a time, while a modification waits for all of them
+ * and keeps the others out.
+ * <br><br>
+ * WARNING: the key type MUST have valid operator< and operator== !
+ * @tparam keyType Type of Key
+ * @tparam valueType Type of Value
+ * @tparam pageSize the size of a page in bytes
+ */
+template <class keyType, class valueType, int pageSize = BufferPool::blockSize>
+class BPlusTree {
+private:
+    typedef offset_t ptr;
+
+    StorageFile _tree;
+
+    FairSharedMutex _mutex; // shared by the readers, and unique for the writers
+
+    unsigned long _version = 0; // changed whenever the keys are changed
+
+    /**
+     * @struct _first_node{root, height, free, end}
+     *
+     * This is the metadata of the tree, which takes the first page.
+     */
+    struct _first_node {
+        ptr root; // the root page (0 for an empty tree)
+
+        int height; // the number of levels (1 for a single leaf)
+
+        ptr free; // the first free page (0 for no free page)
+
+        ptr end; // the end of all the pages
+    } _head;
+
+    // the capacities of a leaf and an internal node, leaving space
+    // for one more element in memory before a node is split
+    static constexpr int _leaf_size = (pageSize - 32) / (sizeof(keyType) + sizeof(valueType)) - 1;
+
+    static constexpr int _internal_size = (pageSize - 32) / (sizeof(keyType) + sizeof(ptr)) - 1;
+
+    /**
+     * @struct _leaf{count, next, key, value}
+     *
+     * This is the page to store data.
+     */
+    struct _leaf {
+        int count;
+
+        ptr next; // the next leaf (0 for the last leaf)
+
+        keyType key[_leaf_size + 1];
+
+        valueType value[_leaf_size + 1];
+    };
+
+    /**
+     * @struct _internal{count, key, child}
+     *
+     * This is the page to store the keys that separate its children.
+     * All the keys in child[i + 1] are no less than key[i].
+     */
+    struct _internal {
+        int count; // the number of keys
+
+        keyType key[_internal_size + 1];
+
+        ptr child[_internal_size + 2];
+    };
+
+    static_assert(_leaf_size >= 3 && sizeof(_leaf) <= pageSize, "the page is too small for a leaf");
+
+    static_assert(_internal_size >= 3 && sizeof(_internal) <= pageSize, "the page is too small for an internal node");
+
+    template <class nodeType>
+    void _read(ptr target, nodeType& node)
+    {
+        _tree.read(target, reinterpret_cast<char*>(&node), sizeof(nodeType));
+    }
+
+    template <class nodeType>
+    void _write(ptr target, const nodeType& node)
+    {
+        _tree.write(target, reinterpret_cast<const char*>(&node), sizeof(nodeType));
+    }
+
+    void _write_head()
+    {
+        _tree.write(0, reinterpret_cast<const char*>(&_head), sizeof(_first_node));
+    }
+
+    /**
+     * This function gets a page, reusing a free page if there is one.
+     * @return the place of the new page
+     */
+    ptr _new_page()
+    {
+        ptr page;
+        if (_head.free != 0) {
+            page = _head.free;
+            _tree.read(page, reinterpret_cast<char*>(&_head.free), sizeof(ptr));
+        } else {
+            page = _head.end;
+            _head.end += pageSize;
+        }
+        return page;
+    }
+
+    /**
+     * This function puts a page into the list of free pages.
+     * @param page
+     */
+    void _delete_page(ptr page)
+    {
+        _tree.write(page, reinterpret_cast<const char*>(&_head.free), sizeof(ptr));
+        _head.free = page;
+    }
+
+    /**
+     * This function returns the index of the first key that is no less
+     * than the given key.
+     */
+    static int _lower_bound(const keyType* keys, int count, const keyType& key)
+    {
+        int leftIndex = 0, rightIndex = count;
+        while (leftIndex < rightIndex) {
+            int middle = (leftIndex + rightIndex) / 2;
+            if (keys[middle] < key) leftIndex = middle + 1;
+            else rightIndex = middle;
+        }
+        return leftIndex;
+    }
+
+    /**
+     * This function returns the index of the first key that is greater
+     * than the given key.
+     */
+    static int _upper_bound(const keyType* keys, int count, const keyType& key)
+    {
+        int leftIndex = 0, rightIndex = count;
+        while (leftIndex < rightIndex) {
+            int middle = (leftIndex + rightIndex) / 2;
+            if (key < keys[middle]) rightIndex = middle;
+            else leftIndex = middle + 1;
+        }
+        return leftIndex;
+    }
+
+    /**
+     * This function returns the leaf that the key belongs to.
+     * <br><br>
+     * WARNING: the tree CANNOT be empty.
+     * @param key
+     * @return the place of the leaf
+     */
+    ptr _find_leaf(const keyType& key)
+    {
+        ptr Ptr = _head.root;
+        _internal node;
+        for (int level = _head.height; level > 1; --level) {
+            _read(Ptr, node);
+            Ptr = node.child[_upper_bound(node.key, node.count, key)];
+        }
+        return Ptr;
+    }
+
+    /**
+     * This function inserts a key-value pair into a subtree.  If the
+     * root of the subtree is split, the key separating the two halves
+     * and the place of the right half will be given back.
+     * @param target the root of the subtree
+     * @param level the height of the subtree
+     * @param key
+     * @param value
+     * @param splitKey the key separating the two halves
+     * @param splitPtr the place of the right half
+     * @return whether the root of the subtree is split
+     */
+    bool _insert(ptr target, int level, const keyType& key, const valueType& value,
+                 keyType& splitKey, ptr& splitPtr)
+    {
+        if (level == 1) { // the case of a leaf
+            _leaf leaf;
+            _read(target, leaf);
+            int position = _lower_bound(leaf.key, leaf.count, key);
+            if (position < leaf.count && leaf.key[position] == key) { // the key exists
+                leaf.value[position] = value;
+                _write(target, leaf);
+                return false;
+            }
+            for (int i = leaf.count; i > position; --i) {
+                leaf.key[i] = leaf.key[i - 1];
+                leaf.value[i] = leaf.value[i - 1];
+            }
+            leaf.key[position] = key;
+            leaf.value[position] = value;
+            ++leaf.count;
+            if (leaf.count <= _leaf_size) {
+                _write(target, leaf);
+                return false;
+            }
+
+            // Split the leaf
+            _leaf right;
+            int leftCount = leaf.count / 2;
+            right.count = leaf.count - leftCount;
+            for (int i = 0; i < right.count; ++i) {
+                right.key[i] = leaf.key[leftCount + i];
+                right.value[i] = leaf.value[leftCount + i];
+            }
+            leaf.count = leftCount;
+            splitPtr = _new_page();
+            right.next = leaf.next;
+            leaf.next = splitPtr;
+            splitKey = right.key[0];
+            _write(target, leaf);
+            _write(splitPtr, right);
+            return true;
+        }
+
+        // the case of an internal node
+        _internal node;
+        _read(target, node);
+        int position = _upper_bound(node.key, node.count, key);
+        keyType childSplitKey;
+        ptr childSplitPtr;
+        if (!_insert(node.child[position], level - 1, key, value, childSplitKey, childSplitPtr)) {
+            return false;
+        }
+
+        // Put the new child right after the split one
+        for (int i = node.count; i > position; --i) {
+            node.key[i] = node.key[i - 1];
+            node.child[i + 1] = node.child[i];
+        }
+        node.key[position] = childSplitKey;
+        node.child[position + 1] = childSplitPtr;
+        ++node.count;
+        if (node.count <= _internal_size) {
+            _write(target, node);
+            return false;
+        }
+
+        // Split the internal node (the middle key goes up)
+        _internal right;
+        int leftCount = node.count / 2;
+        right.count = node.count - leftCount - 1;
+        for (int i = 0; i < right.count; ++i) {
+            right.key[i] = node.key[leftCount + 1 + i];
+            right.child[i] = node.child[leftCount + 1 + i];
+        }
+        right.child[right.count] = node.child[node.count];
+        splitKey = node.key[leftCount];
+        node.count = leftCount;
+        splitPtr = _new_page();
+        _write(target, node);
+        _write(splitPtr, right);
+        return true;
+    }
+
+    /**
+     * This function merges or rebalances a child of an internal node
+     * that has too few elements with one of its siblings.
+     * @param node the parent
+     * @param position the index of the child with too few elements
+     * @param level the height of the child
+     */
+    void _rebalance(_internal& node, int position, int level)
+    {
+        int leftIndex = (position > 0) ? position - 1 : position; // merge child[leftIndex + 1] into child[leftIndex]
+        ptr leftPtr = node.child[leftIndex], rightPtr = node.child[leftIndex + 1];
+
+        if (level == 1) { // the case of leaves
+            _leaf left, right;
+            _read(leftPtr, left);
+            _read(rightPtr, right);
+            if (left.count + right.count <= _leaf_size) { // merge the two leaves
+                for (int i = 0; i < right.count; ++i) {
+                    left.key[left.count + i] = right.key[i];
+                    left.value[left.count + i] = right.value[i];
+                }
+                left.count += right.count;
+                left.next = right.next;
+                _write(leftPtr, left);
+                _delete_page(rightPtr);
+            } else { // share the elements equally
+                int total = left.count + right.count;
+                int leftCount = total / 2;
+                if (left.count < leftCount) { // move from right to left
+                    int move = leftCount - left.count;
+                    for (int i = 0; i < move; ++i) {
+                        left.key[left.count + i] = right.key[i];
+                        left.value[left.count + i] = right.value[i];
+                    }
+                    for (int i = move; i < right.count; ++i) {
+                        right.key[i - move] = right.key[i];
+                        right.value[i - move] = right.value[i];
+                    }
+                    left.count += move;
+                    right.count -= move;
+                } else { // move from left to right
+                    int move = left.count - leftCount;
+                    for (int i = right.count - 1; i >= 0; --i) {
+                        right.key[i + move] = right.key[i];
+                        right.value[i + move] = right.value[i];
+                    }
+                    for (int i = 0; i < move; ++i) {
+                        right.key[i] = left.key[leftCount + i];
+                        right.value[i] = left.value[leftCount + i];
+                    }
+                    left.count -= move;
+                    right.count += move;
+                }
+                node.key[leftIndex] = right.key[0];
+                _write(leftPtr, left);
+                _write(rightPtr, right);
+                return;
+            }
+        } else { // the case of internal nodes
+            _internal left, right;
+            _read(leftPtr, left);
+            _read(rightPtr, right);
+            if (left.count + right.count + 1 <= _internal_size) { // merge the two nodes
+                left.key[left.count] = node.key[leftIndex];
+                for (int i = 0; i < right.count; ++i) {
+                    left.key[left.count + 1 + i] = right.key[i];
+                    left.child[left.count + 1 + i] = right.child[i];
+                }
+                left.child[left.count + 1 + right.count] = right.child[right.count];
+                left.count += right.count + 1;
+                _write(leftPtr, left);
+                _delete_page(rightPtr);
+            } else { // share the keys equally through the parent
+                std::vector<keyType> keys(left.key, left.key + left.count);
+                keys.push_back(node.key[leftIndex]);
+                keys.insert(keys.end(), right.key, right.key + right.count);
+                std::vector<ptr> children(left.child, left.child + left.count + 1);
+                children.insert(children.end(), right.child, right.child + right.count + 1);
+
+                left.count = static_cast<int>(keys.size()) / 2;
+                right.count = static_cast<int>(keys.size()) - left.count - 1;
+                for (int i = 0; i < left.count; ++i) {
+                    left.key[i] = keys[i];
+                    left.child[i] = children[i];
+                }
+                left.child[left.count] = children[left.count];
+                node.key[leftIndex] = keys[left.count];
+                for (int i = 0; i < right.count; ++i) {
+                    right.key[i] = keys[left.count + 1 + i];
+                    right.child[i] = children[left.count + 1 + i];
+                }
+                right.child[right.count] = children.back();
+                _write(leftPtr, left);
+                _write(rightPtr, right);
+                return;
+            }
+        }
+
+        // Remove the merged child from the parent
+        for (int i = leftIndex; i < node.count - 1; ++i) {
+            node.key[i] = node.key[i + 1];
+            node.child[i + 1] = node.child[i + 2];
+        }
+        --node.count;
+    }
+
+    /**
+     * This function erases a key from a subtree.
+     * @param target the root of the subtree
+     * @param level the height of the subtree
+     * @param key
+     * @param count the number of elements left in the root of the subtree
+     * @return whether the key is found
+     */
+    bool _erase(ptr target, int level, const keyType& key, int& count)
+    {
+        if (level == 1) { // the case of a leaf
+            _leaf leaf;
+            _read(target, leaf);
+            int position = _lower_bound(leaf.key, leaf.count, key);
+            if (position == leaf.count || !(leaf.key[position] == key)) return false; // no such key
+            for (int i = position; i < leaf.count - 1; ++i) {
+                leaf.key[i] = leaf.key[i + 1];
+                leaf.value[i] = leaf.value[i + 1];
+            }
+            --leaf.count;
+            count = leaf.count;
+            _write(target, leaf);
+            return true;
+        }
+
+        // the case of an internal node
+        _internal node;
+        _read(target, node);
+        int position = _upper_bound(node.key, node.count, key);
+        int childCount;
+        if (!_erase(node.child[position], level - 1, key, childCount)) return false;
+
+        if (childCount < ((level == 2) ? _leaf_size / 2 : _internal_size / 2)) {
+            _rebalance(node, position, level - 1);
+            _write(target, node);
+        }
+        count = node.count;
+        return true;
+    }
+
+    /**
+     * This function returns the first leaf of the tree.
+     * <br><br>
+     * WARNING: the tree CANNOT be empty.
+     */
+    ptr _first_leaf()
+    {
+        ptr Ptr = _head.root;
+        _internal node;
+        for (int level = _head.height; level > 1; --level) {
+            _read(Ptr, node);
+            Ptr = node.child[0];
+        }
+        return Ptr;
+    }
+
+    /**
+     * This function inserts a new key-value pair (or replaces the value
+     * of the key) without taking the lock.
+     */
+    void _insert_pair(const keyType& key, const valueType& value)
+    {
+        if (_head.root == 0) { // the case of an empty tree
+            _leaf leaf;
+            leaf.count = 1;
+            leaf.next = 0;
+            leaf.key[0] = key;
+            leaf.value[0] = value;
+            _head.root = _new_page();
+            _head.height = 1;
+            _write(_head.root, leaf);
+            _write_head();
+            return;
+        }
+
+        keyType splitKey;
+        ptr splitPtr;
+        if (_insert(_head.root, _head.height, key, value, splitKey, splitPtr)) {
+            // Grow a new root
+            _internal root;
+            root.count = 1;
+            root.key[0] = splitKey;
+            root.child[0] = _head.root;
+            root.child[1] = splitPtr;
+            _head.root = _new_page();
+            ++_head.height;
+            _write(_head.root, root);
+        }
+        _write_head();
+    }
+
+    /**
+     * This function erases a key without taking the lock.
+     */
+    void _erase_key(const keyType& key)
+    {
+        if (_head.root == 0) return;
+        int count;
+        if (!_erase(_head.root, _head.height, key, count)) return; // no such key
+
+        if (count == 0) { // shrink the tree
+            if (_head.height == 1) {
+                _delete_page(_head.root);
+                _head.root = 0;
+                _head.height = 0;
+            } else {
+                _internal root;
+                _read(_head.root, root);
+                _delete_page(_head.root);
+                _head.root = root.child[0];
+                --_head.height;
+            }
+        }
+        _write_head();
+    }
+
+public:
+    /**
+     * @class Cursor
+     *
+     * This is a forward cursor over the values in the order of the keys.
+     * Only one leaf is kept in memory at a time.
+     * <br><br>
+     * The leaves are read under the lock of the tree, so several threads
+     * can move their own cursors at a time, and the tree may be modified
+     * between them: the cursor goes on after the last key it has read,
+     * and sees the keys after it as they are when their leaf is read.
+     */
+    class Cursor {
+        friend class BPlusTree;
+
+    private:
+        BPlusTree* _owner;
+
+        _leaf _leaf_node; // the leaf in memory
+
+        int _index = 0; // the index of the next element in the leaf
+
+        unsigned long _version; // the version of the tree when the leaf was read
+
+        Cursor(BPlusTree* owner, ptr leafPtr, int index) : _owner(owner), _index(index), _version(owner->_version)
+        {
+            _leaf_node.count = 0;
+            _leaf_node.next = 0;
+            if (leafPtr != 0) _owner->_read(leafPtr, _leaf_node);
+            _skip();
+        }
+
+        /**
+         * This function moves to the following leaves if the leaf in
+         * memory has been used up.
+         * <br><br>
+         * WARNING: the lock of the tree MUST be held.
+         */
+        void _skip()
+        {
+            while (_index >= _leaf_node.count && _leaf_node.next != 0) {
+                _owner->_read(_leaf_node.next, _leaf_node);
+                _index = 0;
+            }
+        }
+
+    public:
+        /**
+         * This function tells whether there are more values.
+         */
+        [[nodiscard]] bool hasNext() const
+        {
+            return _index < _leaf_node.count;
+        }
+
+        /**
+         * This function returns the key of the next value.
+         * <br><br>
+         * WARNING: there MUST be more values.
+         */
+        const keyType& peekKey() const
+        {
+            return _leaf_node.key[_index];
+        }
+
+        /**
+         * This function returns the next value and moves forward.
+         * <br><br>
+         * WARNING: there MUST be more values.
+         */
+        valueType next()
+        {
+            valueType value = _leaf_node.value[_index];
+            ++_index;
+            if (_index >= _leaf_node.count) {
+                std::shared_lock<FairSharedMutex> lock(_owner->_mutex);
+                if (_version != _owner->_version) { // the leaves may have been changed
+                    const keyType last = _leaf_node.key[_index - 1];
+                    _version = _owner->_version;
+                    _leaf_node.count = 0;
+                    _leaf_node.next = 0;
+                    if (_owner->_head.root != 0) _owner->_read(_owner->_find_leaf(last), _leaf_node);
+                    _index = _upper_bound(_leaf_node.key, _leaf_node.count, last);
+                }
+                _skip();
+            }
+            return value;
+        }
+    };
+
+    explicit BPlusTree(const std::string& fileName)
+    : _tree(fileName), _head{0, 0, 0, pageSize}
+    {
+        if (_tree.size() == 0) {
+            _write_head();
+        } else {
+            _tree.read(0, reinterpret_cast<char*>(&_head), sizeof(_first_node));
+        }
+    }
+
+    ~BPlusTree() = default;
+
+    /**
+     * This function inserts a new key-value pair.  If the key exists,
+     * its value will be replaced.
+     * @param key the new key
+     * @param value the value of the new key
+     */
+    void insert(const keyType& key, const valueType& value)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        ++_version;
+        _insert_pair(key, value);
+    }
+
+    void erase(const keyType& key)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        ++_version;
+        _erase_key(key);
+    }
+
+    void modify(const keyType& key, const valueType& value)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (_head.root == 0) return;
+        ptr leafPtr = _find_leaf(key);
+        _leaf leaf;
+        _read(leafPtr, leaf);
+        int position = _lower_bound(leaf.key, leaf.count, key);
+        if (position == leaf.count || !(leaf.key[position] == key)) return; // no such key
+        leaf.value[position] = value;
+        _write(leafPtr, leaf);
+    }
+
+    /**
+     * The function clears all the data in the tree
+     */
+    void clear()
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        ++_version;
+        _head = _first_node{0, 0, 0, pageSize};
+        _write_head();
+    }
+
+    /**
+     * This function replaces all the data in the tree with the data in
+     * [begin, end).  The leaves are filled and written one after another
+     * in a single pass, and then the internal nodes are built level by
+     * level.
+     * <br><br>
+     * WARNING: the data MUST be sorted by the key, and the keys MUST be
+     * distinct.
+     * @tparam Iterator an iterator to std::pair<keyType, valueType>
+     * @param begin
+     * @param end
+     * @param fillFactor the ratio of the number of elements in a node to
+     * its capacity (no less than 0.5)
+     */
+    template <class Iterator>
+    void bulkLoad(Iterator begin, Iterator end, double fillFactor = 1.0)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        ++_version;
+        _head = _first_node{0, 0, 0, pageSize};
+        _write_head();
+        if (begin == end) return;
+        const int leafCount = std::clamp(static_cast<int>(fillFactor * _leaf_size),
+                                         (_leaf_size + 1) / 2, _leaf_size);
+        const int childCount = std::clamp(static_cast<int>(fillFactor * _internal_size),
+                                          (_internal_size + 1) / 2, _internal_size) + 1;
+
+        // the first key and the place of each node of the level being built
+        std::vector<std::pair<keyType, ptr>> nodes;
+
+        // Write the leaves (the pages of an empty tree are taken in order)
+        _leaf pre, leaf;
+        while (begin != end) {
+            if (!nodes.empty()) pre = leaf;
+            leaf.count = 0;
+            for (; begin != end && leaf.count < leafCount; ++begin) {
+                leaf.key[leaf.count] = begin->first;
+                leaf.value[leaf.count] = begin->second;
+                ++leaf.count;
+            }
+            ptr page = _new_page();
+            leaf.next = (begin != end) ? page + pageSize : 0;
+            _write(page, leaf);
+            nodes.emplace_back(leaf.key[0], page);
+        }
+
+        // Share the elements of the last two leaves if the last one is too small
+        if (nodes.size() > 1 && leaf.count < (_leaf_size + 1) / 2) {
+            int total = pre.count + leaf.count;
+            int move = pre.count - total / 2;
+            for (int i = leaf.count - 1; i >= 0; --i) {
+                leaf.key[i + move] = leaf.key[i];
+                leaf.value[i + move] = leaf.value[i];
+            }
+            for (int i = 0; i < move; ++i) {
+                leaf.key[i] = pre.key[pre.count - move + i];
+                leaf.value[i] = pre.value[pre.count - move + i];
+            }
+            pre.count -= move;
+            leaf.count += move;
+            _write(nodes[nodes.size() - 2].second, pre);
+            _write(nodes.back().second, leaf);
+            nodes.back().first = leaf.key[0];
+        }
+
+        // Build the internal nodes, sharing the children of a level evenly
+        _head.height = 1;
+        while (nodes.size() > 1) {
+            std::vector<std::pair<keyType, ptr>> parents;
+            size_t groups = (nodes.size() + childCount - 1) / childCount;
+            for (size_t group = 0, index = 0; group < groups; ++group) {
+                size_t size = (nodes.size() - index) / (groups - group);
+                _internal node;
+                node.count = static_cast<int>(size) - 1;
+                node.child[0] = nodes[index].second;
+                for (size_t i = 1; i < size; ++i) {
+                    node.key[i - 1] = nodes[index + i].first;
+                    node.child[i] = nodes[index + i].second;
+                }
+                ptr page = _new_page();
+                _write(page, node);
+                parents.emplace_back(nodes[index].first, page);
+                index += size;
+            }
+            nodes = std::move(parents);
+            ++_head.height;
+        }
+        _head.root = nodes[0].second;
+        _write_head();
+    }
+
+    /**
+     * This function gets the value of a certain key.
+     * @param key
+     * @return the value of a certain key, or std::nullopt if the key
+     * doesn't exist.
+     */
+    std::optional<valueType> get(const keyType& key)
+    {
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        if (_head.root == 0) return std::nullopt;
+        _leaf leaf;
+        _read(_find_leaf(key), leaf);
+        int position = _lower_bound(leaf.key, leaf.count, key);
+        if (position == leaf.count || !(leaf.key[position] == key)) return std::nullopt; // no such key
+        return leaf.value[position];
+    }
+
+    /**
+     * This function gets the values of many keys at a time.  The keys are
+     * sorted, and the keys in the same leaf are found without going down
+     * the tree again, so that each leaf is read at most once.
+     * @param keys
+     * @return the values of the keys in the same order (std::nullopt for
+     * a key that doesn't exist)
+     */
+    std::vector<std::optional<valueType>> multiGet(const std::vector<keyType>& keys)
+    {
+        std::vector<std::optional<valueType>> values(keys.size());
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        if (_head.root == 0) return values;
+
+        std::vector<size_t> order(keys.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&keys](size_t lhs, size_t rhs) { return keys[lhs] < keys[rhs]; });
+
+        _leaf leaf;
+        leaf.count = 0;
+        for (size_t i : order) {
+            const keyType& key = keys[i];
+            // (a key after the last one of the leaf is in another leaf)
+            if (leaf.count == 0 || leaf.key[leaf.count - 1] < key) _read(_find_leaf(key), leaf);
+            int position = _lower_bound(leaf.key, leaf.count, key);
+            if (position < leaf.count && leaf.key[position] == key) values[i] = leaf.value[position];
+        }
+        return values;
+    }
+
+    /**
+     * This function inserts many key-value pairs at a time.  They are
+     * inserted in the order of the keys, so that the pages on the way
+     * are mostly in the buffer.
+     * <br><br>
+     * WARNING: the keys MUST be distinct, and none of them can be in the
+     * tree.
+     * @param pairs
+     */
+    void multiInsert(const std::vector<std::pair<keyType, valueType>>& pairs)
+    {
+        std::vector<std::pair<keyType, valueType>> sorted(pairs);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::pair<keyType, valueType>& lhs, const std::pair<keyType, valueType>& rhs) {
+                      return lhs.first < rhs.first;
+                  });
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        ++_version;
+        for (const std::pair<keyType, valueType>& pair : sorted) _insert_pair(pair.first, pair.second);
+    }
+
+    /**
+     * This function erases many keys at a time in the order of the keys.
+     * @param keys
+     */
+    void multiErase(const std::vector<keyType>& keys)
+    {
+        std::vector<keyType> sorted(keys);
+        std::sort(sorted.begin(), sorted.end());
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        ++_version;
+        for (const keyType& key : sorted) _erase_key(key);
+    }
+
+    /**
+     * The B+ tree has no write buffer, so the capacity is ignored (an
+     * insertion only changes the leaf it belongs to).
+     */
+    void setBufferCapacity([[maybe_unused]] size_t capacity) {}
+
+    std::vector<valueType> traverse()
+    {
+        std::vector<valueType> values;
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        if (_head.root == 0) return values;
+        _leaf leaf;
+        ptr leafPtr = _first_leaf();
+        while (leafPtr != 0) {
+            _read(leafPtr, leaf);
+            values.insert(values.end(), leaf.value, leaf.value + leaf.count);
+            leafPtr = leaf.next;
+        }
+        return values;
+    }
+
+    /**
+     * This function returns the values of a range of keys in order.
+     * @param before the function telling whether a key is before the
+     * range (it MUST be true for all the keys less than some key, and
+     * false for the others)
+     * @param inRange the function telling whether a key (not before
+     * the range) is in the range
+     * @return the values in the range
+     */
+    template <class beforeFunction, class inRangeFunction>
+    std::vector<valueType> traverse(beforeFunction before, inRangeFunction inRange)
+    {
+        std::vector<valueType> values;
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        if (_head.root == 0) return values;
+
+        // Find the leaf of the first key that is not before the range
+        ptr leafPtr = _head.root;
+        _internal node;
+        for (int level = _head.height; level > 1; --level) {
+            _read(leafPtr, node);
+            int position = 0;
+            while (position < node.count && before(node.key[position])) ++position;
+            leafPtr = node.child[position];
+        }
+
+        _leaf leaf;
+        while (leafPtr != 0) {
+            _read(leafPtr, leaf);
+            for (int i = 0; i < leaf.count; ++i) {
+                if (before(leaf.key[i])) continue;
+                if (!inRange(leaf.key[i])) return values;
+                values.push_back(leaf.value[i]);
+            }
+            leafPtr = leaf.next;
+        }
+        return values;
+    }
+
+    /**
+     * This function returns a cursor over all the values.
+     */
+    Cursor cursor()
+    {
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        return Cursor(this, (_head.root == 0) ? 0 : _first_leaf(), 0);
+    }
+
+    /**
+     * This function returns a cursor starting from the first key that is
+     * not before a range.
+     * @param before the function telling whether a key is before the
+     * range (it MUST be true for all the keys less than some key, and
+     * false for the others)
+     */
+    template <class beforeFunction>
+    Cursor cursor(beforeFunction before)
+    {
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        if (_head.root == 0) return Cursor(this, 0, 0);
+
+        // Find the leaf of the first key that is not before the range
+        ptr leafPtr = _head.root;
+        _internal node;
+        for (int level = _head.height; level > 1; --level) {
+            _read(leafPtr, node);
+            int position = 0;
+            while (position < node.count && before(node.key[position])) ++position;
+            leafPtr = node.child[position];
+        }
+
+        Cursor result(this, leafPtr, 0);
+        while (result.hasNext() && before(result.peekKey())) {
+            ++result._index;
+            result._skip();
+        }
+        return result;
+    }
+
+    void flush()
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        _tree.flush();
+    }
+};
+
+/**
+ * @class CompositeBPlusTree
+ *
+ * This is a template class of B+ tree on disk whose key is made of
+ * several fields (see CompositeKey).  It has the same interface as
+ * CompositeUnrolledLinkedList.
+ * <br><br>
+ * WARNING: the key types MUST have valid operator< and operator== !
+ *
+ * @tparam valueType Type of Value
+ * @tparam keyTypes Types of the fields of the key
+ */
+template <class valueType, class... keyTypes>
+class CompositeBPlusTree {
+private:
+    typedef CompositeKeyTraits<valueType, keyTypes...> _traits;
+
+    typedef CompositeKey<keyTypes...> _key;
+
+    BPlusTree<_key, valueType> _tree;
+
+public:
+    /**
+     * @class Cursor
+     *
+     * This is a forward cursor over the values in the order of the keys,
+     * which may be limited to the keys with certain leading fields.  The
+     * tree may be modified while it is used, just as BPlusTree::Cursor.
+     */
+    class Cursor {
+        friend class CompositeBPlusTree;
+
+    private:
+        typename BPlusTree<_key, valueType>::Cursor _cursor;
+
+        // whether a key has the leading fields of the cursor (always true for the whole tree)
+        std::function<bool(const _key&)> _matches;
+
+        Cursor(typename BPlusTree<_key, valueType>::Cursor cursor, std::function<bool(const _key&)> matches)
+        : _cursor(std::move(cursor)), _matches(std::move(matches)) {}
+
+    public:
+        /**
+         * This function tells whether there are more values.
+         */
+        [[nodiscard]] bool hasNext() const
+        {
+            return _cursor.hasNext() && _matches(_cursor.peekKey());
+        }
+
+        /**
+         * This function returns the next value and moves forward.
+         * <br><br>
+         * WARNING: there MUST be more values.
+         */
+        valueType next()
+        {
+            return _cursor.next();
+        }
+    };
+
+    explicit CompositeBPlusTree(const std::string& fileName) : _tree(fileName) {}
+
+    ~CompositeBPlusTree() = default;
+
+    void insert(const keyTypes&... keys, const valueType& value)
+    {
+        _tree.insert(_key(keys...), value);
+    }
+
+    void erase(const keyTypes&... keys)
+    {
+        _tree.erase(_key(keys...));
+    }
+
+    void modify(const keyTypes&... keys, const valueType& value)
+    {
+        _tree.modify(_key(keys...), value);
+    }
+
+    void clear()
+    {
+        _tree.clear();
+    }
+
+    /**
+     * This function replaces all the data in the tree with the data in
+     * [begin, end).
+     * <br><br>
+     * WARNING: the data MUST be sorted by the keys, and the keys MUST be
+     * distinct.
+     * @tparam Iterator an iterator to the key-value pairs (see CompositeKeyTraits)
+     * @param begin
+     * @param end
+     * @param fillFactor the ratio of the number of elements in a node to
+     * its capacity (no less than 0.5)
+     */
+    template <class Iterator>
+    void bulkLoad(Iterator begin, Iterator end, double fillFactor = 1.0)
+    {
+        std::vector<std::pair<_key, valueType>> pairs;
+        for (; begin != end; ++begin) pairs.emplace_back(_traits::toKey(*begin), _traits::toValue(*begin));
+        _tree.bulkLoad(pairs.begin(), pairs.end(), fillFactor);
+    }
+
+    /**
+     * This function gets the value of a certain key.
+     * @return the value of a certain key, or std::nullopt if the key
+     * doesn't exist.
+     */
+    std::optional<valueType> get(const keyTypes&... keys)
+    {
+        return _tree.get(_key(keys...));
+    }
+
+    /**
+     * This function gets the values of many keys at a time.
+     * @param keys the keys (see CompositeKeyTraits)
+     * @return the values of the keys in the same order (std::nullopt for
+     * a key that doesn't exist)
+     */
+    std::vector<std::optional<valueType>> multiGet(const std::vector<typename _traits::keyArgument>& keys)
+    {
+        std::vector<_key> composite;
+        for (const auto& key : keys) composite.push_back(_traits::toKey(key));
+        return _tree.multiGet(composite);
+    }
+
+    /**
+     * This function inserts many key-value pairs at a time.
+     * <br><br>
+     * WARNING: the keys MUST be distinct, and none of them can be in the
+     * tree.
+     * @param entries the key-value pairs (see CompositeKeyTraits)
+     */
+    void multiInsert(const std::vector<typename _traits::entryArgument>& entries)
+    {
+        std::vector<std::pair<_key, valueType>> pairs;
+        for (const auto& entry : entries) pairs.emplace_back(_traits::toKey(entry), _traits::toValue(entry));
+        _tree.multiInsert(pairs);
+    }
+
+    /**
+     * This function erases many keys at a time.
+     * @param keys the keys (see CompositeKeyTraits)
+     */
+    void multiErase(const std::vector<typename _traits::keyArgument>& keys)
+    {
+        std::vector<_key> composite;
+        for (const auto& key : keys) composite.push_back(_traits::toKey(key));
+        _tree.multiErase(composite);
+    }
+
+    void setBufferCapacity(size_t capacity)
+    {
+        _tree.setBufferCapacity(capacity);
+    }
+
+    std::vector<valueType> traverse()
+    {
+        return _tree.traverse();
+    }
+
+    /**
+     * This function returns the values whose leading fields of the key are
+     * the given ones, in the order of the keys.
+     * @param prefix the leading fields (no more than the fields of the key)
+     */
+    template <class... prefixTypes>
+    std::vector<valueType> traverse(const prefixTypes&... prefix)
+    {
+        const typename CompositePrefix<sizeof...(prefixTypes), keyTypes...>::type key(prefix...);
+        return _tree.traverse([&key](const _key& target) { return comparePrefix(target, key) < 0; },
+                              [&key](const _key& target) { return comparePrefix(target, key) == 0; });
+    }
+
+    /**
+     * This function returns a cursor over all the values.
+     */
+    Cursor cursor()
+    {
+        return Cursor(_tree.cursor(), [](const _key&) { return true; });
+    }
+
+    /**
+     * This function returns a cursor over the values whose leading fields
+     * of the key are the given ones.
+     * @param prefix the leading fields (no more than the fields of the key)
+     */
+    template <class... prefixTypes>
+    Cursor cursor(const prefixTypes&... prefix)
+    {
+        const typename CompositePrefix<sizeof...(prefixTypes), keyTypes...>::type key(prefix...);
+        return Cursor(_tree.cursor([&key](const _key& target) { return comparePrefix(target, key) < 0; }),
+                      [key](const _key& target) { return comparePrefix(target, key) == 0; });
+    }
+
+    void flush()
+    {
+        _tree.flush();
+    }
+};
+
+/**
+ * This is the tree of the keys of two fields.
+ */
+template <class keyType1, class keyType2, class valueType>
+using DoubleBPlusTree = CompositeBPlusTree<valueType, keyType1, keyType2>;
+
+#endif // BPLUS_TREE
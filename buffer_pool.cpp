@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+#include "buffer_pool.h"
+#include "journal.h"
+
+void stopOnFailure(const char* operation)
+{
+    std::cerr << "storage: " << operation << " failed: " << std::strerror(errno) << std::endl;
+    std::abort();
+}
+
+int openFile(const std::string& fileName, bool create)
+{
+    int descriptor = ::open(fileName.c_str(), create ? (O_RDWR | O_CREAT) : O_RDWR, 0644);
+    if (descriptor < 0) stopOnFailure("open");
+    return descriptor;
+}
+
+size_t readAt(int descriptor, char* target, size_t length, offset_t position)
+{
+    size_t done = 0;
+    while (done < length) {
+        ssize_t count = pread(descriptor, target + done, length - done, position + static_cast<offset_t>(done));
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) stopOnFailure("read");
+        if (count == 0) break; // the end of the file
+        done += static_cast<size_t>(count);
+    }
+    return done;
+}
+
+void writeAt(int descriptor, const char* source, size_t length, offset_t position)
+{
+    size_t done = 0;
+    while (done < length) {
+        ssize_t count = pwrite(descriptor, source + done, length - done, position + static_cast<offset_t>(done));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) stopOnFailure("write");
+        done += static_cast<size_t>(count);
+    }
+}
+
+void truncateTo(int descriptor, offset_t size)
+{
+    if (ftruncate(descriptor, size) != 0) stopOnFailure("truncate");
+}
+
+void synchronize(int descriptor)
+{
+    if (fsync(descriptor) != 0) stopOnFailure("fsync");
+}
+
+BufferPool::BufferPool(size_t capacity) : _frames(capacity)
+{
+    _flush_order.reserve(_frames.capacity());
+}
+
+BufferPool& BufferPool::instance()
+{
+    static BufferPool pool(4096); // 16 MiB of blocks
+    return pool;
+}
+
+std::recursive_mutex& BufferPool::mutex()
+{
+    return _mutex;
+}
+
+void BufferPool::_link_dirty(CachedFile* file, int slot)
+{
+    _frame& frame = _frames.value(slot);
+    frame.previousDirty = _frame_cache::none;
+    frame.nextDirty = file->_dirty_frames;
+    if (file->_dirty_frames != _frame_cache::none) _frames.value(file->_dirty_frames).previousDirty = slot;
+    file->_dirty_frames = slot;
+}
+
+void BufferPool::_unlink_dirty(CachedFile* file, int slot)
+{
+    _frame& frame = _frames.value(slot);
+    if (frame.previousDirty == _frame_cache::none) file->_dirty_frames = frame.nextDirty;
+    else _frames.value(frame.previousDirty).nextDirty = frame.nextDirty;
+    if (frame.nextDirty != _frame_cache::none) _frames.value(frame.nextDirty).previousDirty = frame.previousDirty;
+}
+
+void BufferPool::_evict(int slot)
+{
+    const _frame_key key = _frames.key(slot);
+    _frame& frame = _frames.value(slot);
+    if (frame.dirty) {
+        key.file->_store(key.blockNo, frame.data);
+        _unlink_dirty(key.file, slot);
+    }
+    _frames.erase(slot);
+}
+
+int BufferPool::_victim() const
+{
+    int slot = _frames.oldest();
+    while (slot != _frame_cache::none && _frames.value(slot).loading) slot = _frames.newer(slot);
+    return slot;
+}
+
+char* BufferPool::fetch(CachedFile* file, long blockNo, bool forWrite, std::unique_lock<std::recursive_mutex>& lock,
+                        bool overwrite)
+{
+    int slot;
+    while (true) {
+        slot = _frames.find(_frame_key{file, blockNo});
+        if (slot != _frame_cache::none && !_frames.value(slot).loading) break; // the block is in the pool
+        if (slot == _frame_cache::none && !_frames.full()) break;
+        if (slot == _frame_cache::none) {
+            const int victim = _victim();
+            if (victim != _frame_cache::none) {
+                _evict(victim); // reuse the least recently used frame
+                break;
+            }
+        }
+        _loaded.wait(lock); // (the block, or every frame, is being loaded by other threads)
+    }
+
+    if (slot != _frame_cache::none) {
+        _frames.touch(slot);
+    } else {
+        slot = _frames.insert(_frame_key{file, blockNo});
+        _frame& frame = _frames.value(slot);
+        frame.dirty = false;
+        frame.loading = false;
+        if (!overwrite) {
+            frame.loading = true;
+            ++_loading_count;
+            file->_load(blockNo, frame.data, lock);
+            frame.loading = false;
+            --_loading_count;
+            _loaded.notify_all();
+        }
+    }
+
+    _frame& frame = _frames.value(slot);
+    if (forWrite && !frame.dirty) {
+        frame.dirty = true;
+        _link_dirty(file, slot);
+    }
+    return frame.data;
+}
+
+bool BufferPool::contains(CachedFile* file, long blockNo) const
+{
+    return _frames.find(_frame_key{file, blockNo}) != _frame_cache::none;
+}
+
+void BufferPool::flush(CachedFile* file)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    // (the blocks are written in their order in the file)
+    _flush_order.clear();
+    for (int slot = file->_dirty_frames; slot != _frame_cache::none; slot = _frames.value(slot).nextDirty) {
+        _flush_order.push_back(slot);
+    }
+    std::sort(_flush_order.begin(), _flush_order.end(),
+              [this](int lhs, int rhs) { return _frames.key(lhs).blockNo < _frames.key(rhs).blockNo; });
+    for (int slot : _flush_order) {
+        _frame& frame = _frames.value(slot);
+        file->_store(_frames.key(slot).blockNo, frame.data);
+        frame.dirty = false;
+    }
+    file->_dirty_frames = _frame_cache::none;
+}
+
+void BufferPool::waitForLoads(std::unique_lock<std::recursive_mutex>& lock)
+{
+    _loaded.wait(lock, [this]() { return _loading_count == 0; });
+}
+
+void BufferPool::drop(CachedFile* file)
+{
+    std::unique_lock<std::recursive_mutex> lock(_mutex);
+    drop(file, lock);
+}
+
+void BufferPool::drop(CachedFile* file, std::unique_lock<std::recursive_mutex>& lock)
+{
+    waitForLoads(lock);
+    flush(file);
+    for (int slot = _frames.oldest(); slot != _frame_cache::none;) {
+        const int next = _frames.newer(slot);
+        if (_frames.key(slot).file == file) _frames.erase(slot);
+        slot = next;
+    }
+}
+
+void BufferPool::setCapacity(size_t capacity)
+{
+    std::unique_lock<std::recursive_mutex> lock(_mutex);
+    waitForLoads(lock);
+    while (_frames.oldest() != _frame_cache::none) _evict(_frames.oldest());
+    _frames = _frame_cache(std::max<size_t>(capacity, 1));
+    _flush_order.reserve(_frames.capacity());
+}
+
+CachedFile::CachedFile(const std::string& fileName) : _descriptor(openFile(fileName)), _file_name(fileName)
+{
+    _disk_size = lseek(_descriptor, 0, SEEK_END);
+    if (_disk_size < 0) stopOnFailure("seek");
+    _size = _disk_size;
+    Journal::instance().attach(this);
+}
+
+CachedFile::~CachedFile()
+{
+    BufferPool::instance().drop(this);
+    Journal::instance().detach(this);
+    ::close(_descriptor);
+}
+
+void CachedFile::_load(long blockNo, char* target, std::unique_lock<std::recursive_mutex>& lock)
+{
+    if (Journal::instance().readBlock(this, blockNo, target, lock)) return;
+    offset_t start = blockNo * BufferPool::blockSize;
+    offset_t length = std::min<offset_t>(BufferPool::blockSize, std::max<offset_t>(_disk_size - start, 0));
+    // (a read cut short by the end of the file is filled with zeros as well)
+    if (length > 0) {
+        lock.unlock();
+        length = static_cast<offset_t>(readAt(_descriptor, target, length, start));
+        lock.lock();
+    }
+    std::memset(target + length, 0, BufferPool::blockSize - length);
+}
+
+void CachedFile::_store(long blockNo, const char* source)
+{
+    Journal& journal = Journal::instance();
+    if (journal.active()) {
+        journal.writeBlock(this, blockNo, source);
+        return;
+    }
+    offset_t start = blockNo * BufferPool::blockSize;
+    offset_t length = std::min<offset_t>(BufferPool::blockSize, _size - start);
+    if (length <= 0) return;
+    writeAt(_descriptor, source, length, start);
+    _disk_size = std::max(_disk_size, start + length);
+}
+
+void CachedFile::read(offset_t position, char* target, offset_t length)
+{
+    BufferPool& pool = BufferPool::instance();
+    std::unique_lock<std::recursive_mutex> lock(pool.mutex());
+    while (length > 0) {
+        long blockNo = static_cast<long>(position / BufferPool::blockSize);
+        offset_t inBlock = position % BufferPool::blockSize;
+        offset_t count = std::min<offset_t>(length, BufferPool::blockSize - inBlock);
+        std::memcpy(target, pool.fetch(this, blockNo, false, lock) + inBlock, count);
+        position += count;
+        target += count;
+        length -= count;
+    }
+}
+
+void CachedFile::write(offset_t position, const char* source, offset_t length)
+{
+    BufferPool& pool = BufferPool::instance();
+    std::unique_lock<std::recursive_mutex> lock(pool.mutex());
+    _size = std::max(_size, position + length);
+    while (length > 0) {
+        long blockNo = static_cast<long>(position / BufferPool::blockSize);
+        offset_t inBlock = position % BufferPool::blockSize;
+        offset_t count = std::min<offset_t>(length, BufferPool::blockSize - inBlock);
+        std::memcpy(pool.fetch(this, blockNo, true, lock, count == BufferPool::blockSize) + inBlock,
+                    source, count);
+        position += count;
+        source += count;
+        length -= count;
+    }
+}
+
+offset_t CachedFile::size() const
+{
+    return _size;
+}
+
+void CachedFile::resize(offset_t size)
+{
+    BufferPool& pool = BufferPool::instance();
+    std::unique_lock<std::recursive_mutex> lock(pool.mutex());
+    pool.drop(this, lock);
+    Journal& journal = Journal::instance();
+    if (journal.active()) { // the file on disk is resized at the next checkpoint
+        journal.resize(this, size);
+        _size = size;
+        _disk_size = std::min(_disk_size, size);
+        offset_t inBlock = size % BufferPool::blockSize;
+        if (inBlock > 0) { // the discarded part of the last block is read as zeros later
+            std::memset(pool.fetch(this, static_cast<long>(size / BufferPool::blockSize), true, lock) + inBlock,
+                        0, BufferPool::blockSize - inBlock);
+        }
+        return;
+    }
+    truncateTo(_descriptor, size);
+    _size = size;
+    _disk_size = size;
+}
+
+void CachedFile::prefetch(offset_t position, offset_t length)
+{
+    BufferPool& pool = BufferPool::instance();
+    std::lock_guard<std::recursive_mutex> lock(pool.mutex());
+    const long first = static_cast<long>(position / BufferPool::blockSize);
+    const long last = static_cast<long>((std::min(position + length, _disk_size) + BufferPool::blockSize - 1) /
+                                        BufferPool::blockSize);
+
+    // Advise each run of blocks that are not in the pool
+    long runStart = -1;
+    for (long blockNo = first; blockNo <= last; ++blockNo) {
+        bool needed = blockNo < last && !pool.contains(this, blockNo);
+        if (needed && runStart < 0) runStart = blockNo;
+        if (!needed && runStart >= 0) {
+            posix_fadvise(_descriptor, runStart * BufferPool::blockSize, (blockNo - runStart) * BufferPool::blockSize,
+                          POSIX_FADV_WILLNEED);
+            runStart = -1;
+        }
+    }
+}
+
+void CachedFile::flush()
+{
+    BufferPool::instance().flush(this);
+}
@@ -0,0 +1,346 @@
+#ifndef BUFFER_POOL
+#define BUFFER_POOL
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "lru_cache.h"
+
+// the type of the offsets in all the data files, which can be changed
+// by defining BOOKSTORE_OFFSET_TYPE at compile time
+#ifdef BOOKSTORE_OFFSET_TYPE
+typedef BOOKSTORE_OFFSET_TYPE offset_t;
+#else
+typedef std::int64_t offset_t;
+#endif
+
+class CachedFile;
+
+/**
+ * This function stops the program when a file of the storage cannot be
+ * read or written.  The commands after it could not be made durable, so
+ * it is safer to stop at once, and the committed commands will be
+ * recovered from the journal when the program is started again.
+ * @param operation
+ */
+[[noreturn]] void stopOnFailure(const char* operation);
+
+/**
+ * This function opens a file for reading and writing.
+ * @param fileName
+ * @param create whether to create the file if it doesn't exist
+ * @return the descriptor
+ */
+int openFile(const std::string& fileName, bool create = false);
+
+/**
+ * This function reads a string of bytes from a file.  Only the end of the
+ * file can make it read less than the given length.
+ * @param descriptor
+ * @param target
+ * @param length
+ * @param position
+ * @return the number of bytes read
+ */
+size_t readAt(int descriptor, char* target, size_t length, offset_t position);
+
+/**
+ * This function writes a string of bytes to a file completely.
+ * @param descriptor
+ * @param source
+ * @param length
+ * @param position
+ */
+void writeAt(int descriptor, const char* source, size_t length, offset_t position);
+
+/**
+ * These functions change the size of a file, and synchronize a file with
+ * the disk.
+ */
+void truncateTo(int descriptor, offset_t size);
+
+void synchronize(int descriptor);
+
+/**
+ * @class BufferPool
+ *
+ * This is a size-bounded pool of disk blocks shared by every cached
+ * file.  The least recently used block is evicted when the pool is
+ * full, and a dirty block is written back to its own file when it is
+ * evicted or when its file is flushed.  The frames are all allocated
+ * when the pool is created (or resized), so fetching a block allocates
+ * nothing.
+ * <br><br>
+ * The pool, the cached files and the journal are guarded by the same
+ * lock, so that they can be used by several threads at a time.  A block
+ * is read from the disk without the lock: its frame is marked as being
+ * loaded, which keeps it from being evicted and makes the other threads
+ * fetching it wait, and the lock is taken again when the block is read.
+ * The dirty blocks are still written back with the lock held, as they
+ * only go to the journal (or to the cache of the system).
+ */
+class BufferPool {
+public:
+    static constexpr long blockSize = 4096;
+
+private:
+    // (the members are not initialized, so the data of a frame is not touched until it is used)
+    struct _frame {
+        bool dirty;
+
+        bool loading; // whether the block is being read without the lock
+
+        int previousDirty; // the dirty frames of a file are linked in both directions
+
+        int nextDirty;
+
+        char data[blockSize];
+    };
+
+    struct _frame_key {
+        CachedFile* file;
+
+        long blockNo;
+
+        bool operator==(const _frame_key& rhs) const
+        {
+            return file == rhs.file && blockNo == rhs.blockNo;
+        }
+    };
+
+    struct _frame_hash {
+        size_t operator()(const _frame_key& key) const
+        {
+            return std::hash<CachedFile*>()(key.file) ^ (std::hash<long>()(key.blockNo) * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    typedef LRUCache<_frame_key, _frame, _frame_hash> _frame_cache;
+
+    _frame_cache _frames;
+
+    std::vector<int> _flush_order; // the dirty frames of a file being flushed (reserved for all the frames)
+
+    int _loading_count = 0; // the number of frames being loaded
+
+    std::recursive_mutex _mutex;
+
+    std::condition_variable_any _loaded; // notified when a frame has been loaded
+
+    explicit BufferPool(size_t capacity);
+
+    /**
+     * These functions add a frame to the dirty frames of its file, and
+     * remove it from them.
+     */
+    void _link_dirty(CachedFile* file, int slot);
+
+    void _unlink_dirty(CachedFile* file, int slot);
+
+    /**
+     * This function writes a frame back if it is dirty, and drops it.
+     * @param slot
+     */
+    void _evict(int slot);
+
+    /**
+     * This function returns the least recently used frame that is not
+     * being loaded.
+     * @return the frame, or none if all of them are being loaded
+     */
+    [[nodiscard]] int _victim() const;
+
+public:
+    BufferPool(const BufferPool&) = delete;
+
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    ~BufferPool() = default;
+
+    /**
+     * This function returns the pool shared by all the cached files.
+     */
+    static BufferPool& instance();
+
+    /**
+     * This function returns the lock of the pool, which also guards all
+     * the cached files and the journal.
+     */
+    std::recursive_mutex& mutex();
+
+    /**
+     * This function returns the data of a block, loading it from the
+     * disk if it is not in the pool.  The block will be marked dirty
+     * if it is fetched for writing.  The lock is released while the block
+     * is read from the disk (or while the block is loaded by another
+     * thread), and it is held again when the function returns.
+     * <br><br>
+     * WARNING: the pointer is only valid until the next call to fetch, and
+     * the lock of the pool MUST be held until it is no longer used.  The
+     * lock MUST be held only once (not by the callers of the caller).
+     * @param file the file that the block belongs to
+     * @param blockNo the index of the block in the file
+     * @param forWrite whether the block will be modified
+     * @param lock the lock of the pool held by the caller
+     * @param overwrite whether the whole block will be overwritten (so
+     * that there is no need to load it)
+     * @return the pointer to the data of the block
+     */
+    char* fetch(CachedFile* file, long blockNo, bool forWrite, std::unique_lock<std::recursive_mutex>& lock,
+                bool overwrite = false);
+
+    /**
+     * This function waits until no block is being loaded, so that the
+     * places that they are read from can be changed.
+     * <br><br>
+     * WARNING: the lock MUST be held only once.
+     * @param lock the lock of the pool held by the caller
+     */
+    void waitForLoads(std::unique_lock<std::recursive_mutex>& lock);
+
+    /**
+     * This function tells whether a block is in the pool.
+     * <br><br>
+     * WARNING: the lock of the pool MUST be held.
+     * @param file
+     * @param blockNo
+     */
+    [[nodiscard]] bool contains(CachedFile* file, long blockNo) const;
+
+    /**
+     * This function writes all the dirty blocks of a file back.
+     * @param file
+     */
+    void flush(CachedFile* file);
+
+    /**
+     * This function writes all the dirty blocks of a file back and
+     * removes all its blocks from the pool.
+     * @param file
+     */
+    void drop(CachedFile* file);
+
+    /**
+     * This function is the same as the one above, with the lock held by
+     * the caller.  It waits for the blocks of the file being loaded.
+     * <br><br>
+     * WARNING: the lock MUST be held only once.
+     * @param file
+     * @param lock the lock of the pool held by the caller
+     */
+    void drop(CachedFile* file, std::unique_lock<std::recursive_mutex>& lock);
+
+    /**
+     * This function changes the number of blocks that the pool can hold.
+     * @param capacity
+     */
+    void setCapacity(size_t capacity);
+};
+
+/**
+ * @class CachedFile
+ *
+ * This is a file on disk whose reads and writes go through the shared
+ * buffer pool.  The positions are byte offsets, and the file grows when
+ * data is written beyond its end.  The blocks are read and written with
+ * positional system calls, so there is no shared position in the file.
+ * <br><br>
+ * WARNING: the file MUST exist before it is opened.
+ */
+class CachedFile {
+    friend class BufferPool;
+
+    friend class Journal;
+
+private:
+    int _descriptor;
+
+    std::string _file_name;
+
+    offset_t _size = 0; // the size including the data that is not written back
+
+    offset_t _disk_size = 0; // the size of the data on disk that is not discarded by resize
+
+    int _dirty_frames = -1; // the first of the frames of the dirty blocks in the pool
+
+    bool _changed = false; // whether it is written back to the journal since the last commit
+
+    bool _unsaved = false; // whether it is written back to the journal since the last checkpoint
+
+    /**
+     * This function reads a block from the journal, or from the disk if
+     * it is not there.  The part beyond the end of the file is filled
+     * with zeros.  The lock is released while the block is read.
+     * @param blockNo
+     * @param target
+     * @param lock the lock of the pool held by the caller
+     */
+    void _load(long blockNo, char* target, std::unique_lock<std::recursive_mutex>& lock);
+
+    /**
+     * This function writes a block back to the journal if it is open, or
+     * to the disk otherwise.  Nothing beyond the end of the file will be
+     * written to the disk.
+     * @param blockNo
+     * @param source
+     */
+    void _store(long blockNo, const char* source);
+
+public:
+    explicit CachedFile(const std::string& fileName);
+
+    CachedFile(const CachedFile&) = delete;
+
+    CachedFile& operator=(const CachedFile&) = delete;
+
+    ~CachedFile();
+
+    /**
+     * This function reads a string of stuff from the file.
+     * @param position the place to get the data
+     * @param target the place to put the data
+     * @param length
+     */
+    void read(offset_t position, char* target, offset_t length);
+
+    /**
+     * This function writes a string of stuff to the file.
+     * @param position the place to put the data
+     * @param source the source pointer
+     * @param length
+     */
+    void write(offset_t position, const char* source, offset_t length);
+
+    /**
+     * This function returns the size of the file.
+     */
+    [[nodiscard]] offset_t size() const;
+
+    /**
+     * This function changes the size of the file.  The data beyond the
+     * new size is discarded, and the new part (if any) is filled with
+     * zeros.
+     * @param size
+     */
+    void resize(offset_t size);
+
+    /**
+     * This function asks the system to read a part of the file ahead,
+     * so that it is already on the way when it is read.  The blocks in
+     * the pool are skipped, and it returns without waiting for the disk.
+     * @param position
+     * @param length
+     */
+    void prefetch(offset_t position, offset_t length);
+
+    /**
+     * This function writes all the dirty blocks back to the disk.
+     */
+    void flush();
+};
+
+#endif //BUFFER_POOL
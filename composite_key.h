@@ -0,0 +1,217 @@
+#ifndef COMPOSITE_KEY
+#define COMPOSITE_KEY
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @struct CompositeKey
+ *
+ * This is a key made of several fields, which is ordered by the first
+ * field, and then by the second one, and so on.  The fields are kept one
+ * after another (the first one and a composite key of the rest), so a key
+ * of fields aligned to a byte (like the strings of the program) has the
+ * same layout as a struct of the fields, and a key of a single field has
+ * the same layout as the field.
+ * <br><br>
+ * WARNING: the types of the fields MUST have valid operator< and
+ * operator== !
+ * @tparam keyTypes the types of the fields
+ */
+template <class... keyTypes>
+struct CompositeKey;
+
+template <class keyType>
+struct CompositeKey<keyType> {
+    static constexpr size_t size = 1;
+
+    keyType first;
+
+    CompositeKey() = default;
+
+    explicit CompositeKey(const keyType& firstIn) : first(firstIn) {}
+
+    bool operator<(const CompositeKey& rhs) const
+    {
+        return first < rhs.first;
+    }
+
+    bool operator==(const CompositeKey& rhs) const
+    {
+        return first == rhs.first;
+    }
+};
+
+template <class keyType, class... restTypes>
+struct CompositeKey<keyType, restTypes...> {
+    static constexpr size_t size = 1 + sizeof...(restTypes);
+
+    keyType first;
+
+    CompositeKey<restTypes...> rest;
+
+    CompositeKey() = default;
+
+    explicit CompositeKey(const keyType& firstIn, const restTypes&... restIn) : first(firstIn), rest(restIn...) {}
+
+    bool operator<(const CompositeKey& rhs) const
+    {
+        return first < rhs.first || (first == rhs.first && rest < rhs.rest);
+    }
+
+    bool operator==(const CompositeKey& rhs) const
+    {
+        return first == rhs.first && rest == rhs.rest;
+    }
+};
+
+/**
+ * This function compares the leading fields of a key with a prefix.
+ * @param key
+ * @param prefix the values of the leading fields (no more than the fields
+ * of the key)
+ * @return a negative number if the leading fields are less than the
+ * prefix, 0 if they are equal, and a positive number otherwise
+ */
+template <class... keyTypes, class... prefixTypes>
+int comparePrefix(const CompositeKey<keyTypes...>& key, const CompositeKey<prefixTypes...>& prefix)
+{
+    static_assert(sizeof...(prefixTypes) <= sizeof...(keyTypes), "the prefix is longer than the key");
+    if (key.first < prefix.first) return -1;
+    if (!(key.first == prefix.first)) return 1;
+    if constexpr (sizeof...(prefixTypes) == 1) {
+        return 0;
+    } else {
+        return comparePrefix(key.rest, prefix.rest);
+    }
+}
+
+/**
+ * This function calls a function with each field of a key and the same
+ * field of the previous key in order, which is how the fields are front
+ * coded one after another.
+ * @param key the key (which may be changed by the function)
+ * @param previous the previous key (nullptr for the first one)
+ * @param function a function taking (field, pointer to the previous field)
+ */
+template <class compositeType, class functionType>
+void forEachField(compositeType& key, const std::remove_const_t<compositeType>* previous, functionType&& function)
+{
+    function(key.first, (previous == nullptr) ? nullptr : &previous->first);
+    if constexpr (std::remove_const_t<compositeType>::size > 1) {
+        forEachField(key.rest, (previous == nullptr) ? nullptr : &previous->rest, function);
+    }
+}
+
+/**
+ * @struct CompositeKeyTraits
+ *
+ * These are the types used to pass composite keys to the indexes: a key
+ * of a single field is passed as the field, a key of two fields as a
+ * std::pair, and a longer one as a std::tuple.  A key-value pair is
+ * passed as a std::pair for a single field, and as a std::tuple of the
+ * fields and the value otherwise.
+ */
+template <class valueType, class... keyTypes>
+struct CompositeKeyTraits {
+    typedef CompositeKey<keyTypes...> key;
+
+    typedef std::tuple<keyTypes...> keyArgument;
+
+    typedef std::tuple<keyTypes..., valueType> entryArgument;
+
+    static key toKey(const keyArgument& argument)
+    {
+        return std::make_from_tuple<key>(argument);
+    }
+
+    static key toKey(const entryArgument& argument)
+    {
+        return _to_key(argument, std::index_sequence_for<keyTypes...>());
+    }
+
+    static const valueType& toValue(const entryArgument& argument)
+    {
+        return std::get<sizeof...(keyTypes)>(argument);
+    }
+
+private:
+    template <size_t... indexes>
+    static key _to_key(const entryArgument& argument, std::index_sequence<indexes...>)
+    {
+        return key(std::get<indexes>(argument)...);
+    }
+};
+
+template <class valueType, class keyType>
+struct CompositeKeyTraits<valueType, keyType> {
+    typedef CompositeKey<keyType> key;
+
+    typedef keyType keyArgument;
+
+    typedef std::pair<keyType, valueType> entryArgument;
+
+    static key toKey(const keyArgument& argument)
+    {
+        return key(argument);
+    }
+
+    static key toKey(const entryArgument& argument)
+    {
+        return key(argument.first);
+    }
+
+    static const valueType& toValue(const entryArgument& argument)
+    {
+        return argument.second;
+    }
+};
+
+template <class valueType, class keyType1, class keyType2>
+struct CompositeKeyTraits<valueType, keyType1, keyType2> {
+    typedef CompositeKey<keyType1, keyType2> key;
+
+    typedef std::pair<keyType1, keyType2> keyArgument;
+
+    typedef std::tuple<keyType1, keyType2, valueType> entryArgument;
+
+    static key toKey(const keyArgument& argument)
+    {
+        return key(argument.first, argument.second);
+    }
+
+    static key toKey(const entryArgument& argument)
+    {
+        return key(std::get<0>(argument), std::get<1>(argument));
+    }
+
+    static const valueType& toValue(const entryArgument& argument)
+    {
+        return std::get<2>(argument);
+    }
+};
+
+/**
+ * @struct CompositePrefix
+ *
+ * This is the composite key of the first count fields.
+ */
+template <size_t count, class... keyTypes>
+struct CompositePrefix;
+
+template <class keyType, class... restTypes>
+struct CompositePrefix<1, keyType, restTypes...> {
+    typedef CompositeKey<keyType> type;
+};
+
+template <size_t count, class keyType, class... restTypes>
+struct CompositePrefix<count, keyType, restTypes...> {
+    template <class... prefixTypes>
+    static CompositeKey<keyType, prefixTypes...> _prepend(CompositeKey<prefixTypes...>*);
+
+    typedef decltype(_prepend(static_cast<typename CompositePrefix<count - 1, restTypes...>::type*>(nullptr))) type;
+};
+
+#endif //COMPOSITE_KEY
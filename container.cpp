@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "container.h"
+#include "journal.h"
+
+// the first bytes of a container
+const char containerMagic[8] = "BKSTORE";
+
+Container::Container() : _super{}
+{
+    // they are used when the container is destroyed, so they have to be constructed before it
+    BufferPool::instance();
+    Journal::instance();
+}
+
+Container::~Container()
+{
+    close();
+}
+
+Container& Container::instance()
+{
+    static Container container;
+    return container;
+}
+
+void Container::_write_back()
+{
+#ifndef BOOKSTORE_MMAP
+    Journal& journal = Journal::instance();
+    if (!_directory_dirty && journal.active()) {
+        if (_super_dirty) journal.writeBytes(_physical.get(), 0, reinterpret_cast<char*>(&_super), sizeof(_superblock));
+        for (auto& file : _files) {
+            if (!file.second.dirty) continue;
+            offset_t fields[3] = {file.second.spare, file.second.size,
+                                  file.second.maps.empty() ? 0 : file.second.maps.front()};
+            journal.writeBytes(_physical.get(),
+                               static_cast<offset_t>(sizeof(_superblock) + file.second.entry * sizeof(_entry) +
+                                                     offsetof(_entry, spare)),
+                               reinterpret_cast<char*>(fields), sizeof(fields));
+        }
+    } else
+#endif
+    if (_super_dirty || _directory_dirty ||
+        std::any_of(_files.begin(), _files.end(), [](const auto& file) { return file.second.dirty; })) {
+        std::memset(_first_page, 0, pageSize);
+        std::memcpy(_first_page, &_super, sizeof(_superblock));
+        for (const auto& file : _files) {
+            _entry entry{};
+            std::strcpy(entry.name, file.first.c_str());
+            entry.spare = file.second.spare;
+            entry.size = file.second.size;
+            entry.mapPage = file.second.maps.empty() ? 0 : file.second.maps.front();
+            std::memcpy(_first_page + sizeof(_superblock) + file.second.entry * sizeof(_entry), &entry, sizeof(_entry));
+        }
+        _physical->write(0, _first_page, pageSize);
+    }
+    _super_dirty = false;
+    _directory_dirty = false;
+    for (auto& file : _files) file.second.dirty = false;
+}
+
+offset_t Container::_allocate()
+{
+    static const char zeros[pageSize] = {};
+    offset_t page;
+    if (_super.freePage != 0) {
+        page = _super.freePage;
+        _physical->read(page * pageSize, reinterpret_cast<char*>(&_super.freePage), sizeof(offset_t));
+    } else {
+        page = _super.pageCount++;
+    }
+    _physical->write(page * pageSize, zeros, pageSize);
+    _super_dirty = true;
+    return page;
+}
+
+void Container::_free(offset_t page)
+{
+    _physical->write(page * pageSize, reinterpret_cast<char*>(&_super.freePage), sizeof(offset_t));
+    _super.freePage = page;
+    _super_dirty = true;
+}
+
+offset_t Container::_allocate_data(_file& file)
+{
+    static const char zeros[pageSize] = {};
+    if (file.spareCount == 0) { // a new spare run
+        const offset_t wanted = std::clamp<offset_t>(static_cast<offset_t>(file.pages.size()), 1, _max_spare_pages);
+        if (_super.freePage != 0) {
+            file.spare = _super.freePage;
+            while (file.spareCount < wanted && _super.freePage == file.spare + file.spareCount) {
+                _physical->read(_super.freePage * pageSize, reinterpret_cast<char*>(&_super.freePage), sizeof(offset_t));
+                ++file.spareCount;
+            }
+        } else {
+            file.spare = _super.pageCount;
+            file.spareCount = wanted;
+            _super.pageCount += wanted;
+        }
+        _super_dirty = true;
+    }
+
+    const offset_t page = file.spare;
+    if (--file.spareCount == 0) {
+        file.spare = 0;
+    } else {
+        ++file.spare;
+        _write_spare(file);
+    }
+    _physical->write(page * pageSize, zeros, pageSize);
+    file.dirty = true;
+    return page;
+}
+
+void Container::_write_spare(_file& file)
+{
+    _physical->write(file.spare * pageSize, reinterpret_cast<char*>(&file.spareCount), sizeof(offset_t));
+}
+
+void Container::_free_spare(_file& file)
+{
+    for (offset_t page = file.spare + file.spareCount; page > file.spare; --page) _free(page - 1);
+    file.spare = 0;
+    file.spareCount = 0;
+    file.dirty = true;
+}
+
+void Container::_reserve(_file& file, size_t pageCount)
+{
+    if (file.pages.capacity() >= pageCount) return;
+    const size_t capacity = std::max({pageCount, 2 * file.pages.capacity(), file.reservedPages});
+    file.pages.reserve(capacity);
+    file.maps.reserve((capacity + _pages_per_map - 1) / _pages_per_map);
+}
+
+size_t Container::_reserved_pages_of(const std::string& name)
+{
+    return (name == "log" || name == "finance_log") ? _log_reserved_pages : _reserved_pages;
+}
+
+Container::_file& Container::_open_file(const std::string& name)
+{
+    auto iter = _files.find(name);
+    if (iter != _files.end()) return iter->second;
+
+    if (name.size() >= sizeof(_entry::name)) throw std::length_error("the name of the file is too long");
+    std::vector<bool> used(_max_files, false);
+    for (const auto& file : _files) used[file.second.entry] = true;
+    int index = static_cast<int>(std::find(used.begin(), used.end(), false) - used.begin());
+    if (index == _max_files) throw std::length_error("too many files in the container");
+
+    _directory_dirty = true;
+    return _files.emplace(name, _file{index, 0, {}, {}, 0, 0, false, _reserved_pages_of(name)}).first->second;
+}
+
+void Container::_resize(_file& file, offset_t size)
+{
+    const size_t pageCount = (size + pageSize - 1) / pageSize;
+    const size_t mapCount = (pageCount + _pages_per_map - 1) / _pages_per_map;
+
+    // the part of the last page beyond the new size is read as zeros later
+    if (size < file.size && size % pageSize != 0) {
+        static const char zeros[pageSize] = {};
+        offset_t inPage = size % pageSize;
+        _physical->write(file.pages[size / pageSize] * pageSize + inPage, zeros, pageSize - inPage);
+    }
+    // (the pages right before the spare run go back into it, so that a file truncated often keeps its pages)
+    const offset_t spare = file.spare;
+    while (file.pages.size() > pageCount) {
+        const offset_t page = file.pages.back();
+        if ((file.spareCount == 0 || page + 1 == file.spare) && file.spareCount < _max_spare_pages) {
+            file.spare = page;
+            ++file.spareCount;
+        } else {
+            _free(page);
+        }
+        file.pages.pop_back();
+    }
+    if (file.spare != spare) _write_spare(file);
+    if (file.maps.size() > mapCount) {
+        while (file.maps.size() > mapCount) {
+            _free(file.maps.back());
+            file.maps.pop_back();
+        }
+        if (!file.maps.empty()) { // the end of the chain
+            offset_t next = 0;
+            _physical->write(file.maps.back() * pageSize, reinterpret_cast<char*>(&next), sizeof(offset_t));
+        }
+    }
+
+    _reserve(file, pageCount);
+    while (file.pages.size() < pageCount) {
+        offset_t index = static_cast<offset_t>(file.pages.size());
+        if (index % _pages_per_map == 0) { // a new map page is needed
+            offset_t map = _allocate();
+            if (!file.maps.empty()) {
+                _physical->write(file.maps.back() * pageSize, reinterpret_cast<char*>(&map), sizeof(offset_t));
+            }
+            file.maps.push_back(map);
+        }
+        offset_t page = _allocate_data(file);
+        _physical->write(file.maps.back() * pageSize +
+                         (1 + index % _pages_per_map) * static_cast<offset_t>(sizeof(offset_t)),
+                         reinterpret_cast<char*>(&page), sizeof(offset_t));
+        file.pages.push_back(page);
+    }
+
+    file.size = size;
+    file.dirty = true;
+}
+
+void Container::open(const std::string& fileName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::ifstream tester(fileName);
+    if (!(tester.good())) {
+        std::ofstream creator(fileName);
+        creator.close();
+    }
+    tester.close();
+    _physical = std::make_unique<PhysicalFile>(fileName);
+
+    if (_physical->size() == 0) { // a new container
+        std::memcpy(_super.magic, containerMagic, sizeof(containerMagic));
+        _super.pageCount = 1;
+        _super.freePage = 0;
+        _directory_dirty = true;
+        _write_back();
+        return;
+    }
+
+    _physical->read(0, reinterpret_cast<char*>(&_super), sizeof(_superblock));
+    std::vector<offset_t> map(pageSize / sizeof(offset_t));
+    for (int index = 0; index < _max_files; ++index) {
+        _entry entry;
+        _physical->read(static_cast<offset_t>(sizeof(_superblock) + index * sizeof(_entry)),
+                        reinterpret_cast<char*>(&entry), sizeof(_entry));
+        if (entry.name[0] == '\0') continue;
+        entry.name[sizeof(entry.name) - 1] = '\0';
+
+        _file file{index, entry.size, {}, {}, entry.spare, 0, false, _reserved_pages_of(entry.name)};
+        if (file.spare != 0) {
+            _physical->read(file.spare * pageSize, reinterpret_cast<char*>(&file.spareCount), sizeof(offset_t));
+        }
+        const size_t pageCount = (entry.size + pageSize - 1) / pageSize;
+        _reserve(file, pageCount);
+        offset_t mapPage = entry.mapPage;
+        while (file.pages.size() < pageCount) {
+            _physical->read(mapPage * pageSize, reinterpret_cast<char*>(map.data()), pageSize);
+            file.maps.push_back(mapPage);
+            size_t count = std::min<size_t>(pageCount - file.pages.size(), _pages_per_map);
+            file.pages.insert(file.pages.end(), map.begin() + 1, map.begin() + 1 + count);
+            mapPage = map[0];
+        }
+        _files.emplace(entry.name, std::move(file));
+    }
+}
+
+void Container::close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_physical == nullptr) return;
+    _write_back();
+    _physical.reset();
+    _files.clear();
+}
+
+bool Container::exists(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _files.count(name) != 0;
+}
+
+void Container::remove(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto iter = _files.find(name);
+    if (iter == _files.end()) return;
+    _resize(iter->second, 0);
+    _free_spare(iter->second);
+    _files.erase(iter);
+    _directory_dirty = true;
+}
+
+void Container::flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _write_back();
+    _physical->flush();
+}
+
+ContainerFile::ContainerFile(const std::string& fileName)
+{
+    Container& container = Container::instance();
+    std::lock_guard<std::mutex> lock(container._mutex);
+    _file = &container._open_file(fileName);
+}
+
+void ContainerFile::read(offset_t position, char* target, offset_t length)
+{
+    PhysicalFile& physical = *Container::instance()._physical;
+    while (length > 0) {
+        offset_t pageNo = position / Container::pageSize;
+        offset_t inPage = position % Container::pageSize;
+        offset_t count = std::min<offset_t>(length, Container::pageSize - inPage);
+        if (pageNo < static_cast<offset_t>(_file->pages.size())) {
+            physical.read(_file->pages[pageNo] * Container::pageSize + inPage, target, count);
+        } else { // the part beyond the end of the file is read as zeros
+            std::memset(target, 0, count);
+        }
+        position += count;
+        target += count;
+        length -= count;
+    }
+}
+
+void ContainerFile::write(offset_t position, const char* source, offset_t length)
+{
+    Container& container = Container::instance();
+    if (position + length > _file->size) {
+        std::lock_guard<std::mutex> lock(container._mutex);
+        container._resize(*_file, position + length);
+    }
+    while (length > 0) {
+        offset_t pageNo = position / Container::pageSize;
+        offset_t inPage = position % Container::pageSize;
+        offset_t count = std::min<offset_t>(length, Container::pageSize - inPage);
+        container._physical->write(_file->pages[pageNo] * Container::pageSize + inPage, source, count);
+        position += count;
+        source += count;
+        length -= count;
+    }
+}
+
+offset_t ContainerFile::size() const
+{
+    return _file->size;
+}
+
+void ContainerFile::resize(offset_t size)
+{
+    Container& container = Container::instance();
+    std::lock_guard<std::mutex> lock(container._mutex);
+    container._resize(*_file, size);
+}
+
+void ContainerFile::prefetch(offset_t position, offset_t length)
+{
+    PhysicalFile& physical = *Container::instance()._physical;
+    const size_t first = position / Container::pageSize;
+    const size_t last = std::min<size_t>((std::min(position + length, _file->size) + Container::pageSize - 1) /
+                                         Container::pageSize, _file->pages.size());
+    offset_t runStart = 0, runEnd = 0; // the run of pages in the container
+    for (size_t pageNo = first; pageNo < last; ++pageNo) {
+        offset_t page = _file->pages[pageNo];
+        if (page != runEnd) {
+            if (runEnd != runStart) {
+                physical.prefetch(runStart * Container::pageSize, (runEnd - runStart) * Container::pageSize);
+            }
+            runStart = page;
+        }
+        runEnd = page + 1;
+    }
+    if (runEnd != runStart) {
+        physical.prefetch(runStart * Container::pageSize, (runEnd - runStart) * Container::pageSize);
+    }
+}
+
+void ContainerFile::flush()
+{
+    Container::instance().flush();
+}
@@ -0,0 +1,343 @@
+#ifndef CONTAINER
+#define CONTAINER
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+
+// The backend of the container is chosen at compile time: define
+// BOOKSTORE_MMAP to map it into the memory instead of reading it
+// through the buffer pool.  Both of them use the same format.
+
+#ifdef BOOKSTORE_MMAP
+
+#include "mapped_file.h"
+
+typedef MappedFile PhysicalFile;
+
+#else
+
+typedef CachedFile PhysicalFile;
+
+#endif
+
+/**
+ * @class Container
+ *
+ * This is the only data file on disk, which holds all the named files
+ * of the program (the records and the indexes).  It is made of pages of
+ * pageSize bytes: the first one is the superblock with the directory of
+ * the named files, and the others are handed out to all the named files
+ * by the same allocator, so a page freed by one of them can be reused by
+ * any other.  The pages of a named file are listed in a chain of map
+ * pages, whose head is kept in the directory.
+ * <br><br>
+ * A growing named file takes its pages from a run of pages next to each
+ * other set aside for it (the spare run), which is about as long as the
+ * file itself, so that the files do not interleave and a file is read
+ * ahead in a few long runs.  The first page of the spare run keeps its
+ * length, just like a free page keeps the next one.
+ * <br><br>
+ * The superblock and the map pages are written through the backend just
+ * like the data, so the journal covers them as well, and a checkpoint
+ * makes the whole store consistent at once.
+ * <br><br>
+ * The directory and the allocator are guarded by a lock, so that the
+ * named files can be used by several threads at a time, as long as a
+ * named file is not read while it is written.
+ */
+class Container {
+    friend class ContainerFile;
+
+public:
+    static constexpr offset_t pageSize = BufferPool::blockSize;
+
+    static constexpr const char* defaultName = "database"; // the name of the container on disk
+
+private:
+    /**
+     * @struct _superblock{magic, pageCount, freePage}
+     *
+     * This is the metadata at the head of the container, followed by
+     * the directory.
+     */
+    struct _superblock {
+        char magic[8];
+
+        offset_t pageCount; // the number of pages in the container
+
+        offset_t freePage; // the first page of the free list (0 if it is empty)
+    } _super;
+
+    bool _super_dirty = false; // whether the superblock has been changed since it was written
+
+    bool _directory_dirty = false; // whether a named file has been created or removed since then
+
+    /**
+     * @struct _entry{name, spare, size, mapPage}
+     *
+     * This is a named file in the directory.
+     */
+    struct _entry {
+        char name[48 - sizeof(offset_t)]; // empty for an entry that is not used
+
+        offset_t spare; // the first page of the spare run (0 if there is none)
+
+        offset_t size;
+
+        offset_t mapPage; // the first map page (0 for an empty file)
+    };
+
+    static constexpr int _max_files = static_cast<int>((pageSize - sizeof(_superblock)) / sizeof(_entry));
+
+    // the first slot of a map page is the next map page, and the rest are the pages of the data
+    static constexpr offset_t _pages_per_map = pageSize / static_cast<offset_t>(sizeof(offset_t)) - 1;
+
+    /**
+     * @struct _file{entry, size, pages, maps, spare, spareCount, dirty, reservedPages}
+     *
+     * This is a named file kept in the memory while the container is open.
+     */
+    struct _file {
+        int entry; // the index in the directory
+
+        offset_t size;
+
+        std::vector<offset_t> pages; // the pages of the data in order
+
+        std::vector<offset_t> maps; // the map pages in order
+
+        offset_t spare; // the first page of the spare run (0 if there is none)
+
+        offset_t spareCount; // the number of pages in the spare run
+
+        bool dirty; // whether the entry has been changed since it was written
+
+        size_t reservedPages; // the number of pages that the page table holds at least without growing
+    };
+
+    // the number of pages that the page table of a named file holds at least without growing (2 MiB of data)
+    static constexpr size_t _reserved_pages = _pages_per_map;
+
+    // the same for the logs, which the buy path grows, so that it doesn't allocate (128 MiB of data)
+    static constexpr size_t _log_reserved_pages = 64 * _pages_per_map;
+
+    // the most pages of a spare run (1 MiB of data)
+    static constexpr offset_t _max_spare_pages = 256;
+
+    std::unique_ptr<PhysicalFile> _physical; // nullptr if the container is not open
+
+    char _first_page[pageSize]; // the image of the first page to be written back
+
+    std::map<std::string, _file> _files;
+
+    std::mutex _mutex;
+
+    Container();
+
+    /**
+     * This function writes the superblock and the entries that have been
+     * changed, which are only changed in the memory before, so that they
+     * are written once for a command.
+     * <br><br>
+     * If only the sizes and the allocator are changed, which is what most
+     * of the commands do, the changed bytes are appended to the journal
+     * instead of the image of the whole first page.  Otherwise (or if the
+     * journal is not open) the whole first page is written again.
+     */
+    void _write_back();
+
+    /**
+     * This function takes a page from the free list (or from the end of
+     * the container if the list is empty) and fills it with zeros.
+     * @return the page
+     */
+    offset_t _allocate();
+
+    /**
+     * This function puts a page into the free list.
+     * @param page
+     */
+    void _free(offset_t page);
+
+    /**
+     * This function takes the next page of a named file from its spare
+     * run and fills it with zeros.  If the spare run is used up, a new one
+     * as long as the file (up to _max_spare_pages) is taken from the free
+     * list, as far as the free pages there are next to each other, or
+     * from the end of the container otherwise.
+     * @param file
+     * @return the page
+     */
+    offset_t _allocate_data(_file& file);
+
+    /**
+     * This function writes the length of the spare run of a named file
+     * into its first page.
+     * @param file
+     */
+    void _write_spare(_file& file);
+
+    /**
+     * This function puts the spare run of a named file into the free
+     * list, from the last page, so that the run is taken again in order.
+     * @param file
+     */
+    void _free_spare(_file& file);
+
+    /**
+     * This function makes the page table of a named file able to hold a
+     * number of pages without growing.  It doubles the table (from the
+     * reserved pages of the file), so a growing file allocates only a few
+     * times.
+     * @param file
+     * @param pageCount
+     */
+    static void _reserve(_file& file, size_t pageCount);
+
+    /**
+     * This function returns the number of pages that the page table of a
+     * named file holds at least without growing.
+     * @param name
+     */
+    static size_t _reserved_pages_of(const std::string& name);
+
+    /**
+     * This function returns a named file, and creates it if it doesn't
+     * exist.
+     * @param name
+     * @return the named file
+     */
+    _file& _open_file(const std::string& name);
+
+    /**
+     * This function changes the size of a named file, allocating or
+     * freeing its pages.  The data beyond the new size is discarded, and
+     * the new part (if any) is filled with zeros.  The pages given up
+     * right before the spare run go back into it.
+     * @param file
+     * @param size
+     */
+    void _resize(_file& file, offset_t size);
+
+public:
+    Container(const Container&) = delete;
+
+    Container& operator=(const Container&) = delete;
+
+    ~Container();
+
+    /**
+     * This function returns the container shared by all the named files.
+     */
+    static Container& instance();
+
+    /**
+     * This function opens the container (and creates it if it doesn't
+     * exist).
+     * <br><br>
+     * WARNING: it MUST be called before any of the named files is opened,
+     * and after the journal is opened.
+     * @param fileName
+     */
+    void open(const std::string& fileName);
+
+    /**
+     * This function writes everything back and closes the container.
+     * <br><br>
+     * WARNING: all the named files MUST be closed before.
+     */
+    void close();
+
+    /**
+     * This function returns whether there is a named file.
+     * @param name
+     */
+    [[nodiscard]] bool exists(const std::string& name);
+
+    /**
+     * This function removes a named file and frees all its pages.
+     * <br><br>
+     * WARNING: the named file MUST NOT be open.
+     * @param name
+     */
+    void remove(const std::string& name);
+
+    /**
+     * This function writes the superblock, the directory and all the dirty
+     * pages of the container back.
+     */
+    void flush();
+};
+
+/**
+ * @class ContainerFile
+ *
+ * This is a named file in the container.  It has the same interface as
+ * CachedFile, and the positions are translated into the pages of the
+ * container, so the data of a page is never split.
+ * <br><br>
+ * The named file is created when it is opened for the first time.
+ */
+class ContainerFile {
+private:
+    Container::_file* _file;
+
+public:
+    explicit ContainerFile(const std::string& fileName);
+
+    ContainerFile(const ContainerFile&) = delete;
+
+    ContainerFile& operator=(const ContainerFile&) = delete;
+
+    ~ContainerFile() = default;
+
+    /**
+     * This function reads a string of stuff from the file.
+     * @param position the place to get the data
+     * @param target the place to put the data
+     * @param length
+     */
+    void read(offset_t position, char* target, offset_t length);
+
+    /**
+     * This function writes a string of stuff to the file.
+     * @param position the place to put the data
+     * @param source the source pointer
+     * @param length
+     */
+    void write(offset_t position, const char* source, offset_t length);
+
+    /**
+     * This function returns the size of the file.
+     */
+    [[nodiscard]] offset_t size() const;
+
+    /**
+     * This function changes the size of the file.  The data beyond the
+     * new size is discarded, and the new part (if any) is filled with
+     * zeros.
+     * @param size
+     */
+    void resize(offset_t size);
+
+    /**
+     * This function asks the backend to read a part of the file ahead.
+     * The runs of pages that are next to each other in the container are
+     * read ahead together.
+     * @param position
+     * @param length
+     */
+    void prefetch(offset_t position, offset_t length);
+
+    /**
+     * This function writes all the dirty pages of the container back.
+     */
+    void flush();
+};
+
+#endif //CONTAINER
@@ -0,0 +1,94 @@
+#ifndef FAIR_SHARED_MUTEX
+#define FAIR_SHARED_MUTEX
+
+#include <condition_variable>
+#include <mutex>
+
+/**
+ * @class FairSharedMutex
+ *
+ * This is a reader-writer lock that prefers the writers: once a writer
+ * is waiting, no more readers get in, so a stream of readers cannot keep
+ * the writers out forever (std::shared_mutex lets the readers in as long
+ * as one of them holds it on some systems).  It can be used with
+ * std::shared_lock and std::unique_lock.
+ * <br><br>
+ * WARNING: a thread holding it for reading CANNOT take it for reading
+ * again, or it waits forever once a writer is waiting.
+ */
+class FairSharedMutex {
+private:
+    std::mutex _mutex;
+
+    std::condition_variable _readers_gate; // the readers wait here while there is a writer
+
+    std::condition_variable _writers_gate; // the writers wait here while there are readers
+
+    int _readers = 0; // the number of readers holding the lock
+
+    int _waiting_writers = 0;
+
+    bool _writing = false; // whether a writer holds the lock
+
+public:
+    FairSharedMutex() = default;
+
+    FairSharedMutex(const FairSharedMutex&) = delete;
+
+    FairSharedMutex& operator=(const FairSharedMutex&) = delete;
+
+    void lock()
+    {
+        std::unique_lock<std::mutex> guard(_mutex);
+        ++_waiting_writers;
+        _writers_gate.wait(guard, [this]() { return !_writing && _readers == 0; });
+        --_waiting_writers;
+        _writing = true;
+    }
+
+    bool try_lock()
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_writing || _readers != 0) return false;
+        _writing = true;
+        return true;
+    }
+
+    void unlock()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _writing = false;
+        }
+        // (the readers are let in only if no writer is waiting)
+        _writers_gate.notify_one();
+        _readers_gate.notify_all();
+    }
+
+    void lock_shared()
+    {
+        std::unique_lock<std::mutex> guard(_mutex);
+        _readers_gate.wait(guard, [this]() { return !_writing && _waiting_writers == 0; });
+        ++_readers;
+    }
+
+    bool try_lock_shared()
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_writing || _waiting_writers != 0) return false;
+        ++_readers;
+        return true;
+    }
+
+    void unlock_shared()
+    {
+        bool last;
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            last = (--_readers == 0);
+        }
+        if (last) _writers_gate.notify_one();
+    }
+};
+
+#endif //FAIR_SHARED_MUTEX
@@ -0,0 +1,122 @@
+#ifndef FRONT_CODING
+#define FRONT_CODING
+
+#include <cstring>
+#include <vector>
+
+// The following functions front code a field of a sorted array: the
+// field is stored as the length of the prefix that it shares with the
+// same field of the previous element, the length of the rest, and the
+// rest itself.  The zeros at the end of the field are not stored, so a
+// short string in a long char array takes only a few bytes.
+
+/**
+ * This function returns the length of a field without the zeros at its end.
+ * @param field
+ * @return the length
+ */
+template <class fieldType>
+size_t trimmedLength(const fieldType& field)
+{
+    const char* bytes = reinterpret_cast<const char*>(&field);
+    size_t length = sizeof(fieldType);
+    while (length > 0 && bytes[length - 1] == 0) --length;
+    return length;
+}
+
+/**
+ * This function returns the length of the prefix that a field shares with
+ * the previous one.
+ * @param field
+ * @param previous nullptr for the first element
+ * @param length the length of the field without the zeros at its end
+ * @return the length of the shared prefix (no more than length)
+ */
+template <class fieldType>
+size_t sharedLength(const fieldType& field, const fieldType* previous, size_t length)
+{
+    if (previous == nullptr) return 0;
+    const char* bytes = reinterpret_cast<const char*>(&field);
+    const char* previousBytes = reinterpret_cast<const char*>(previous);
+    size_t shared = 0;
+    while (shared < length && bytes[shared] == previousBytes[shared]) ++shared;
+    return shared;
+}
+
+/**
+ * This function returns the number of bytes of a front-coded field.
+ * @param field
+ * @param previous nullptr for the first element
+ * @return the number of bytes
+ */
+template <class fieldType>
+size_t frontCodedLength(const fieldType& field, const fieldType* previous)
+{
+    size_t length = trimmedLength(field);
+    return 2 + length - sharedLength(field, previous, length);
+}
+
+/**
+ * This function appends a front-coded field to the code.
+ * @param code
+ * @param field
+ * @param previous nullptr for the first element
+ */
+template <class fieldType>
+void frontEncode(std::vector<char>& code, const fieldType& field, const fieldType* previous)
+{
+    static_assert(sizeof(fieldType) < 256, "the field is too long to be front coded");
+    size_t length = trimmedLength(field);
+    size_t shared = sharedLength(field, previous, length);
+    const char* bytes = reinterpret_cast<const char*>(&field);
+    code.push_back(static_cast<char>(shared));
+    code.push_back(static_cast<char>(length - shared));
+    code.insert(code.end(), bytes + shared, bytes + length);
+}
+
+/**
+ * This function decodes a front-coded field.
+ * @param code the beginning of the code of the field
+ * @param field the place to put the field
+ * @param previous the previous field that has been decoded (nullptr for
+ * the first element)
+ * @return the end of the code of the field
+ */
+template <class fieldType>
+const char* frontDecode(const char* code, fieldType& field, const fieldType* previous)
+{
+    auto shared = static_cast<unsigned char>(code[0]);
+    auto rest = static_cast<unsigned char>(code[1]);
+    char* bytes = reinterpret_cast<char*>(&field);
+    if (shared > 0) std::memcpy(bytes, previous, shared);
+    std::memcpy(bytes + shared, code + 2, rest);
+    std::memset(bytes + shared + rest, 0, sizeof(fieldType) - shared - rest);
+    return code + 2 + rest;
+}
+
+/**
+ * This function appends a field to the code as it is.
+ * @param code
+ * @param field
+ */
+template <class fieldType>
+void plainEncode(std::vector<char>& code, const fieldType& field)
+{
+    const char* bytes = reinterpret_cast<const char*>(&field);
+    code.insert(code.end(), bytes, bytes + sizeof(fieldType));
+}
+
+/**
+ * This function decodes a field stored as it is.
+ * @param code the beginning of the code of the field
+ * @param field the place to put the field
+ * @return the end of the code of the field
+ */
+template <class fieldType>
+const char* plainDecode(const char* code, fieldType& field)
+{
+    std::memcpy(reinterpret_cast<char*>(&field), code, sizeof(fieldType));
+    return code + sizeof(fieldType);
+}
+
+#endif //FRONT_CODING
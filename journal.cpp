@@ -0,0 +1,278 @@
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <unistd.h>
+#include <vector>
+
+#include "journal.h"
+
+/**
+ * This function computes the FNV-1a hash of a string of bytes.
+ * @param data
+ * @param length
+ * @param hash the hash of the bytes before them
+ * @return the hash
+ */
+unsigned fnvHash(const char* data, size_t length, unsigned hash = 2166136261u)
+{
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Journal::~Journal()
+{
+    if (active()) close();
+}
+
+Journal& Journal::instance()
+{
+    static Journal journal;
+    return journal;
+}
+
+offset_t Journal::_append(_record& record, const char* block)
+{
+    const offset_t blockLength = (record.type == pageRecord) ? BufferPool::blockSize :
+                                 (record.type == patchRecord) ? record.length : 0;
+    const size_t length = sizeof(_record) + static_cast<size_t>(blockLength);
+    record.checksum = 0;
+    std::memcpy(_buffer.data(), &record, sizeof(_record));
+    if (blockLength > 0) std::memcpy(_buffer.data() + sizeof(_record), block, blockLength);
+    record.checksum = fnvHash(_buffer.data(), length);
+    std::memcpy(_buffer.data(), &record, sizeof(_record));
+
+    writeAt(_descriptor, _buffer.data(), length, _end);
+    _end += static_cast<offset_t>(length);
+    return _end - blockLength;
+}
+
+void Journal::_mark(CachedFile* file)
+{
+    file->_changed = true;
+    file->_unsaved = true;
+    _changed = true;
+}
+
+void Journal::_recover()
+{
+    std::vector<char> buffer(sizeof(_record) + BufferPool::blockSize);
+    std::vector<std::vector<char>> command; // the records of the command that is not committed yet
+    std::map<std::string, int> descriptors; // of the data files
+    offset_t place = 0;
+    while (true) {
+        if (pread(_descriptor, buffer.data(), sizeof(_record), place) != sizeof(_record)) break;
+        _record record;
+        std::memcpy(&record, buffer.data(), sizeof(_record));
+        if (record.type == patchRecord && (record.length < 0 || record.length > BufferPool::blockSize)) break;
+        const size_t length = sizeof(_record) + ((record.type == pageRecord) ? BufferPool::blockSize :
+                                                 (record.type == patchRecord) ? record.length : 0);
+        if (length > sizeof(_record) &&
+            pread(_descriptor, buffer.data() + sizeof(_record), length - sizeof(_record),
+                  place + static_cast<offset_t>(sizeof(_record))) !=
+            static_cast<ssize_t>(length - sizeof(_record))) break;
+        const unsigned checksum = record.checksum;
+        record.checksum = 0;
+        std::memcpy(buffer.data(), &record, sizeof(_record));
+        if (fnvHash(buffer.data(), length) != checksum) break; // a record that is not written completely
+        place += static_cast<offset_t>(length);
+
+        if (record.type != commitRecord) {
+            command.emplace_back(buffer.begin(), buffer.begin() + length);
+            continue;
+        }
+        for (const std::vector<char>& data : command) {
+            std::memcpy(&record, data.data(), sizeof(_record));
+            record.fileName[sizeof(record.fileName) - 1] = '\0';
+            auto iter = descriptors.find(record.fileName);
+            if (iter == descriptors.end()) {
+                iter = descriptors.emplace(record.fileName, openFile(record.fileName, true)).first;
+            }
+            if (record.type == pageRecord) {
+                writeAt(iter->second, data.data() + sizeof(_record), BufferPool::blockSize,
+                        record.blockNo * BufferPool::blockSize);
+            } else if (record.type == patchRecord) {
+                writeAt(iter->second, data.data() + sizeof(_record), record.length, record.position);
+            } else {
+                truncateTo(iter->second, record.size);
+            }
+        }
+        command.clear();
+    }
+
+    for (const auto& descriptor : descriptors) {
+        synchronize(descriptor.second);
+        ::close(descriptor.second);
+    }
+}
+
+void Journal::_checkpoint()
+{
+    if (fdatasync(_descriptor) != 0) stopOnFailure("fdatasync");
+    _unsynchronized = 0;
+
+    char block[BufferPool::blockSize];
+    for (CachedFile* file : _files) {
+        if (!file->_unsaved) continue;
+        file->_unsaved = false;
+        int descriptor = openFile(file->_file_name);
+        // the blocks beyond the size on disk are all in the journal or filled with zeros
+        truncateTo(descriptor, file->_disk_size);
+        for (auto iter = _images.lower_bound(std::make_pair(file, 0L));
+             iter != _images.end() && iter->first.first == file; ++iter) {
+            if (readAt(_descriptor, block, BufferPool::blockSize, iter->second) != BufferPool::blockSize) stopOnFailure("read");
+            writeAt(descriptor, block, BufferPool::blockSize, iter->first.second * BufferPool::blockSize);
+        }
+        for (auto iter = _patches.lower_bound(std::make_pair(file, offset_t(0)));
+             iter != _patches.end() && iter->first.first == file; ++iter) {
+            writeAt(descriptor, iter->second.data(), iter->second.size(), iter->first.second);
+        }
+        truncateTo(descriptor, file->_size);
+        file->_disk_size = file->_size;
+        synchronize(descriptor);
+        ::close(descriptor);
+    }
+    _images.clear();
+    _patches.clear();
+
+    truncateTo(_descriptor, 0);
+    _end = 0;
+    synchronize(_descriptor);
+}
+
+void Journal::open(const std::string& fileName)
+{
+    std::lock_guard<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    _descriptor = openFile(fileName, true);
+    _recover();
+    truncateTo(_descriptor, 0);
+    _end = 0;
+    synchronize(_descriptor);
+}
+
+void Journal::close()
+{
+    if (!active()) return;
+    std::unique_lock<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    BufferPool::instance().waitForLoads(lock);
+    for (CachedFile* file : _files) BufferPool::instance().flush(file);
+    commit();
+    _checkpoint();
+    ::close(_descriptor);
+    _descriptor = -1;
+}
+
+bool Journal::active() const
+{
+    return _descriptor >= 0;
+}
+
+void Journal::attach(CachedFile* file)
+{
+    std::lock_guard<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    _files.insert(file);
+}
+
+void Journal::detach(CachedFile* file)
+{
+    std::unique_lock<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    if (active()) {
+        BufferPool::instance().waitForLoads(lock);
+        commit();
+        _checkpoint();
+    }
+    _files.erase(file);
+}
+
+void Journal::writeBlock(CachedFile* file, long blockNo, const char* block)
+{
+    std::lock_guard<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    _record record;
+    std::memset(&record, 0, sizeof(_record));
+    record.type = pageRecord;
+    std::strncpy(record.fileName, file->_file_name.c_str(), sizeof(record.fileName) - 1);
+    record.blockNo = blockNo;
+    _images[std::make_pair(file, blockNo)] = _append(record, block);
+    // (the image is newer than the patches of the block)
+    _patches.erase(_patches.lower_bound(std::make_pair(file, blockNo * BufferPool::blockSize)),
+                   _patches.lower_bound(std::make_pair(file, (blockNo + 1) * BufferPool::blockSize)));
+    _mark(file);
+}
+
+void Journal::writeBytes(CachedFile* file, offset_t position, const char* source, offset_t length)
+{
+    std::lock_guard<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    _record record;
+    std::memset(&record, 0, sizeof(_record));
+    record.type = patchRecord;
+    std::strncpy(record.fileName, file->_file_name.c_str(), sizeof(record.fileName) - 1);
+    record.position = position;
+    record.length = length;
+    _append(record, source);
+    _patches[std::make_pair(file, position)].assign(source, length);
+    _mark(file);
+}
+
+bool Journal::readBlock(CachedFile* file, long blockNo, char* target, std::unique_lock<std::recursive_mutex>& lock)
+{
+    auto iter = _images.find(std::make_pair(file, blockNo));
+    if (iter == _images.end()) return false;
+    const offset_t place = iter->second;
+    lock.unlock();
+    const size_t length = readAt(_descriptor, target, BufferPool::blockSize, place);
+    lock.lock();
+    if (length != BufferPool::blockSize) stopOnFailure("read");
+    return true;
+}
+
+void Journal::resize(CachedFile* file, offset_t size)
+{
+    std::lock_guard<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    const long firstDiscarded = static_cast<long>((size + BufferPool::blockSize - 1) / BufferPool::blockSize);
+    _images.erase(_images.lower_bound(std::make_pair(file, firstDiscarded)),
+                  _images.upper_bound(std::make_pair(file, std::numeric_limits<long>::max())));
+    _patches.erase(_patches.lower_bound(std::make_pair(file, size)),
+                   _patches.upper_bound(std::make_pair(file, std::numeric_limits<offset_t>::max())));
+
+    _record record;
+    std::memset(&record, 0, sizeof(_record));
+    record.type = sizeRecord;
+    std::strncpy(record.fileName, file->_file_name.c_str(), sizeof(record.fileName) - 1);
+    record.size = size;
+    _append(record);
+    _mark(file);
+}
+
+void Journal::commit()
+{
+    std::unique_lock<std::recursive_mutex> lock(BufferPool::instance().mutex());
+    if (!active() || !_changed) return;
+
+    // the final sizes of the files, as the last blocks are written completely
+    _record record;
+    for (CachedFile* file : _files) {
+        if (!file->_changed) continue;
+        file->_changed = false;
+        std::memset(&record, 0, sizeof(_record));
+        record.type = sizeRecord;
+        std::strncpy(record.fileName, file->_file_name.c_str(), sizeof(record.fileName) - 1);
+        record.size = file->_size;
+        _append(record);
+    }
+    _changed = false;
+
+    std::memset(&record, 0, sizeof(_record));
+    record.type = commitRecord;
+    _append(record);
+
+    if (++_unsynchronized >= groupSize) {
+        if (fdatasync(_descriptor) != 0) stopOnFailure("fdatasync");
+        _unsynchronized = 0;
+    }
+    if (_end >= checkpointSize) {
+        BufferPool::instance().waitForLoads(lock);
+        _checkpoint();
+    }
+}
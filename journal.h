@@ -0,0 +1,208 @@
+#ifndef JOURNAL
+#define JOURNAL
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.h"
+
+/**
+ * @class Journal
+ *
+ * This is an append-only file that records the blocks written back by
+ * every cached file.  When the journal is open, the data files are not
+ * changed by the commands: a dirty block is appended to the journal
+ * instead, and is read from there until the next checkpoint, which
+ * copies the newest image of every block into its data file.
+ * <br><br>
+ * A command becomes durable when its commit record is synchronized
+ * with the disk, which is done once for a group of commands.  If the
+ * program crashes, the committed commands are replayed when the journal
+ * is opened again, and the rest are discarded, so that the data files
+ * never contain part of a command.
+ * <br><br>
+ * The journal is guarded by the lock of the buffer pool.  A checkpoint
+ * waits for the blocks being read without the lock.
+ * <br><br>
+ * WARNING: the files written through the memory mapping are not covered.
+ */
+class Journal {
+public:
+    static constexpr int groupSize = 32; // the number of commands committed with one synchronization
+
+    static constexpr offset_t checkpointSize = 64 << 20; // the size of the journal to make a checkpoint
+
+private:
+    enum _record_type {pageRecord, sizeRecord, commitRecord, patchRecord};
+
+    struct _record {
+        _record_type type;
+
+        char fileName[64];
+
+        long blockNo; // only for the page records
+
+        offset_t size; // only for the size records
+
+        offset_t position; // only for the patch records (the place of the bytes in the file)
+
+        offset_t length; // only for the patch records (the number of the bytes after the record)
+
+        unsigned checksum; // of the record (with this field being 0) and the block after it
+    };
+
+    int _descriptor = -1;
+
+    offset_t _end = 0; // the size of the journal
+
+    int _unsynchronized = 0; // the number of commits that are not synchronized with the disk
+
+    std::set<CachedFile*> _files;
+
+    bool _changed = false; // whether any file is written back since the last commit (see CachedFile::_changed)
+
+    std::vector<char> _buffer = std::vector<char>(sizeof(_record) + BufferPool::blockSize); // the record to append
+
+    std::map<std::pair<CachedFile*, long>, offset_t> _images; // the place of the newest image of every block
+
+    // the newest bytes of the patches that are not covered by a newer image, by their places
+    std::map<std::pair<CachedFile*, offset_t>, std::string> _patches;
+
+    Journal() = default;
+
+    /**
+     * This function appends a record, and the block after it if it is
+     * a page record (or the bytes after it if it is a patch record), to
+     * the journal.
+     * @param record
+     * @param block
+     * @return the place of the block in the journal
+     */
+    offset_t _append(_record& record, const char* block = nullptr);
+
+    /**
+     * This function marks a file written back since the last commit and
+     * the last checkpoint.
+     * @param file
+     */
+    void _mark(CachedFile* file);
+
+    /**
+     * This function applies every committed record of the journal to
+     * the data files, which is what is done when the journal is opened.
+     * The records after the last commit record are discarded.
+     */
+    void _recover();
+
+    /**
+     * This function copies the newest image of every block into its data
+     * file and makes the journal empty.
+     * <br><br>
+     * WARNING: it MUST be called just after a commit, when no block is
+     * being loaded (see BufferPool::waitForLoads).
+     */
+    void _checkpoint();
+
+public:
+    Journal(const Journal&) = delete;
+
+    Journal& operator=(const Journal&) = delete;
+
+    ~Journal();
+
+    /**
+     * This function returns the journal shared by all the cached files.
+     */
+    static Journal& instance();
+
+    /**
+     * This function opens the journal and replays the commands committed
+     * before the last crash, if any.
+     * <br><br>
+     * WARNING: it MUST be called before any of the data files is opened.
+     * @param fileName
+     */
+    void open(const std::string& fileName);
+
+    /**
+     * This function commits the remaining commands and writes everything
+     * into the data files.  The blocks are written into the data files
+     * directly after the journal is closed.
+     */
+    void close();
+
+    /**
+     * This function returns whether the journal is open.
+     */
+    [[nodiscard]] bool active() const;
+
+    void attach(CachedFile* file);
+
+    /**
+     * This function makes a checkpoint (if the journal is open) so that
+     * nothing of the file is left in the journal.
+     * @param file
+     */
+    void detach(CachedFile* file);
+
+    /**
+     * This function appends the image of a block to the journal.
+     * @param file
+     * @param blockNo
+     * @param block
+     */
+    void writeBlock(CachedFile* file, long blockNo, const char* block);
+
+    /**
+     * This function appends a few bytes of a file to the journal instead
+     * of the image of the whole block, which is much cheaper for a small
+     * change of a block that is written back after every command.  The
+     * bytes are copied into the data file at the next checkpoint, after
+     * the images.
+     * <br><br>
+     * WARNING: the block in the buffer pool is NOT changed, so the caller
+     * MUST write the whole block again (with the patched bytes) before it
+     * reads or writes the block through the pool, and the patches of a
+     * block MUST NOT overlap unless they are of the same place and length.
+     * @param file
+     * @param position the place of the bytes in the file
+     * @param source
+     * @param length no more than a block
+     */
+    void writeBytes(CachedFile* file, offset_t position, const char* source, offset_t length);
+
+    /**
+     * This function reads the newest image of a block from the journal.
+     * The lock is released while the image is read, as the images are
+     * never moved until the next checkpoint, which waits for it.
+     * @param file
+     * @param blockNo
+     * @param target
+     * @param lock the lock of the pool held by the caller
+     * @return whether there is such an image in the journal
+     */
+    bool readBlock(CachedFile* file, long blockNo, char* target, std::unique_lock<std::recursive_mutex>& lock);
+
+    /**
+     * This function records that the size of a file is changed, and
+     * forgets the images of the blocks beyond the new size.
+     * @param file
+     * @param size
+     */
+    void resize(CachedFile* file, offset_t size);
+
+    /**
+     * This function marks the end of a command.  The blocks written back
+     * since the last commit become a part of the data files once the
+     * commit is synchronized with the disk.
+     * <br><br>
+     * WARNING: the dirty blocks of the command MUST be written back
+     * (by flush) before calling this function.
+     */
+    void commit();
+};
+
+#endif //JOURNAL
@@ -4,43 +4,41 @@
 #include "log.h"
 #include "book.h"
 
-LogGroup::LogGroup()
-{
-    std::ifstream tester("log");
-    if (tester.good()) { // such file exists
-        tester.close();
-        _logs.open("log");
-    } else { // no such file
-        tester.close();
-
-        // create file
-        std::ofstream fileCreator("log");
-        fileCreator.close();
+// the number of bytes read ahead in a scan of a log file
+constexpr offset_t readAheadSize = 64 * BufferPool::blockSize;
 
-        // open the file
-        _logs.open("log");
+/**
+ * This function reads a record in a scan of a log file from the front to
+ * the back.  Whenever the scan comes to a new half of the part read
+ * ahead, the part after it is read ahead, so that the disk is kept busy
+ * while the records are handled.
+ * @param file
+ * @param position the place of the record
+ * @param record the place to put the record
+ */
+template <class recordType>
+void scanRecord(StorageFile& file, offset_t position, recordType& record)
+{
+    if (position % (readAheadSize / 2) < static_cast<offset_t>(sizeof(recordType))) {
+        file.prefetch(position, readAheadSize);
     }
+    file.read(position, reinterpret_cast<char*>(&record), sizeof(recordType));
+}
 
-    tester.open("finance_log");
-    if (tester.good()) { // such file exists
-        tester.close();
-        _finance_logs.open("finance_log");
-    } else { // no such file
-        tester.close();
-
-        // create file
-        std::ofstream fileCreator("finance_log");
-        fileCreator.close();
-
-        // open the file
-        _finance_logs.open("finance_log");
-    }
+/**
+ * This function tells whether a record of the log is about a book (the
+ * one at its offset in the file of the books).
+ * @param log
+ */
+bool aboutBook(const Log& log)
+{
+    return log.behaviour == Log::buy || log.behaviour == Log::create || log.behaviour == Log::modify ||
+           log.behaviour == Log::import;
 }
 
 void LogGroup::addFinanceLog(FinanceLog& newLog)
 {
-    _finance_logs.seekp(0, std::ios::end);
-    _finance_logs.write(reinterpret_cast<const char*>(&newLog), sizeof(FinanceLog));
+    _finance_logs.write(_finance_logs.size(), reinterpret_cast<const char*>(&newLog), sizeof(FinanceLog));
 }
 
 void LogGroup::show(TokenScanner& line, const LoggingSituation& loggingStatus)
@@ -62,24 +60,20 @@ void LogGroup::show(TokenScanner& line, const LoggingSituation& loggingStatus)
                       << income <<'\t' << expenditure << std::endl;
             return;
         }
-        _finance_logs.seekp(0, std::ios::end);
-        const int end = _finance_logs.tellp();
+        const offset_t end = _finance_logs.size();
         if (end / sizeof(FinanceLog) < limit) throw InvalidCommand("Invalid");
         FinanceLog financeLog;
-        for (int i = end - limit * sizeof(FinanceLog); i < end; i += sizeof(FinanceLog)) {
-            _finance_logs.seekg(i);
-            _finance_logs.read(reinterpret_cast<char*>(&financeLog), sizeof(FinanceLog));
+        for (offset_t i = end - limit * sizeof(FinanceLog); i < end; i += sizeof(FinanceLog)) {
+            scanRecord(_finance_logs, i, financeLog);
             if (financeLog.flag) income += financeLog.sum;
             else expenditure += financeLog.sum;
         }
     } else {
-        _finance_logs.seekp(0, std::ios::end);
-        const int end = _finance_logs.tellp();
+        const offset_t end = _finance_logs.size();
         FinanceLog financeLog;
         std::cout << std::fixed << std::setprecision(2);
-        for (int i = 0; i < end; i += sizeof(FinanceLog)) {
-            _finance_logs.seekg(i);
-            _finance_logs.read(reinterpret_cast<char*>(&financeLog), sizeof(FinanceLog));
+        for (offset_t i = 0; i < end; i += sizeof(FinanceLog)) {
+            scanRecord(_finance_logs, i, financeLog);
             if (financeLog.flag) income += financeLog.sum;
             else expenditure += financeLog.sum;
         }
@@ -104,50 +98,49 @@ void LogGroup::report(TokenScanner& line, const LoggingSituation& loggingStatus,
     if (mode == "myself") {
         if (loggingStatus.getPriority() < 3) throw InvalidCommand("Invalid");
         UserID myself(loggingStatus.getID());
-        _logs.seekp(0, std::ios::end);
-        const int end = _logs.tellp();
-        _logs.seekg(0);
+        const offset_t end = _logs.size();
         Log tmpLog;
-        for (int i = 0; i < end; i += sizeof(Log)) {
-            _logs.read(reinterpret_cast<char*>(&tmpLog), sizeof(Log));
+        for (offset_t i = 0; i < end; i += sizeof(Log)) {
+            scanRecord(_logs, i, tmpLog);
             if (tmpLog.userID == myself) {
+                const Book book = aboutBook(tmpLog) ? bookGroup.find(tmpLog.offset) : Book();
                 if (tmpLog.behaviour == Log::buy) {
                     std::cout << "You bought  : " << tmpLog.quantity << " ";
-                    if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                    if (book.name.name[0] == '\0') {
                         std::cout << "< blank name >";
                     } else {
-                        std::cout << bookGroup.find(tmpLog.offset).name.name;
+                        std::cout << book.name.name;
                     }
-                    std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                    std::cout << " (ISBN=" << book.isbn.isbn
                               << ") with $" << std::fixed << std::setprecision(2)
                               << tmpLog.sum << std::endl;
                 } else if (tmpLog.behaviour == Log::modify) {
                     std::cout << "You modified: ";
-                    if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                    if (book.name.name[0] == '\0') {
                         std::cout << "< blank name >";
                     } else {
-                        std::cout << bookGroup.find(tmpLog.offset).name.name;
+                        std::cout << book.name.name;
                     }
-                    std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                    std::cout << " (ISBN=" << book.isbn.isbn
                               << ") " << tmpLog.description << std::endl;
                 } else if (tmpLog.behaviour == Log::import) {
                     std::cout << "You imported: " << tmpLog.quantity << " ";
-                    if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                    if (book.name.name[0] == '\0') {
                         std::cout << "< blank name >";
                     } else {
-                        std::cout << bookGroup.find(tmpLog.offset).name.name;
+                        std::cout << book.name.name;
                     }
-                    std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                    std::cout << " (ISBN=" << book.isbn.isbn
                               << ") with $" << std::fixed << std::setprecision(2)
                               << tmpLog.sum << std::endl;
                 } else if (tmpLog.behaviour == Log::create) {
                     std::cout << "You created : ";
-                    if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                    if (book.name.name[0] == '\0') {
                         std::cout << "< blank name >";
                     } else {
-                        std::cout << bookGroup.find(tmpLog.offset).name.name;
+                        std::cout << book.name.name;
                     }
-                    std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                    std::cout << " (ISBN=" << book.isbn.isbn
                               << ")" << std::endl;
                 } else if (tmpLog.behaviour == Log::login) {
                     std::cout << "You login" << std::endl;
@@ -175,61 +168,59 @@ void LogGroup::report(TokenScanner& line, const LoggingSituation& loggingStatus,
 
 void LogGroup::addLog(Log& newLog)
 {
-    _logs.seekp(0, std::ios::end);
-    _logs.write(reinterpret_cast<const char*>(&newLog), sizeof(Log));
+    _logs.write(_logs.size(), reinterpret_cast<const char*>(&newLog), sizeof(Log));
 }
 
 void LogGroup::showLog(TokenScanner& line, const LoggingSituation& loggingStatus, BookGroup& bookGroup)
 {
     if (loggingStatus.getPriority() < 7 || line.hasMoreToken()) throw InvalidCommand("Invalid");
-    _logs.seekp(0, std::ios::end);
-    const int end = _logs.tellp();
-    _logs.seekg(0);
+    const offset_t end = _logs.size();
     Log tmpLog;
-    for (int i = 0; i < end; i += sizeof(Log)) {
-        _logs.read(reinterpret_cast<char*>(&tmpLog), sizeof(Log));
+    for (offset_t i = 0; i < end; i += sizeof(Log)) {
+        scanRecord(_logs, i, tmpLog);
+        const Book book = aboutBook(tmpLog) ? bookGroup.find(tmpLog.offset) : Book();
         if (tmpLog.behaviour == Log::buy) {
             std::cout << "[" << tmpLog.userID.ID << "]\tbought  : "
                       << tmpLog.quantity << " ";
-            if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+            if (book.name.name[0] == '\0') {
                 std::cout << "< blank name >";
             } else {
-                std::cout << bookGroup.find(tmpLog.offset).name.name;
+                std::cout << book.name.name;
             }
-            std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+            std::cout << " (ISBN=" << book.isbn.isbn
                       << ") with $" << std::fixed << std::setprecision(2)
                       << tmpLog.sum << std::endl;
 
         } else if (tmpLog.behaviour == Log::modify) {
             std::cout << "[" << tmpLog.userID.ID << "]\tmodified: ";
-            if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+            if (book.name.name[0] == '\0') {
                 std::cout << "< blank name >";
             } else {
-                std::cout << bookGroup.find(tmpLog.offset).name.name;
+                std::cout << book.name.name;
             }
-            std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+            std::cout << " (ISBN=" << book.isbn.isbn
                       << ") " << tmpLog.description << std::endl;
 
         } else if (tmpLog.behaviour == Log::import) {
             std::cout << "[" << tmpLog.userID.ID << "]\timported: "
                       << tmpLog.quantity << " ";
-            if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+            if (book.name.name[0] == '\0') {
                 std::cout << "< blank name >";
             } else {
-                std::cout << bookGroup.find(tmpLog.offset).name.name;
+                std::cout << book.name.name;
             }
-            std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+            std::cout << " (ISBN=" << book.isbn.isbn
                       << ") with $" << std::fixed << std::setprecision(2)
                       << tmpLog.sum << std::endl;
 
         } else if (tmpLog.behaviour == Log::create) {
             std::cout << "[" << tmpLog.userID.ID << "]\tcreated : ";
-            if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+            if (book.name.name[0] == '\0') {
                 std::cout << "< blank name >";
             } else {
-                std::cout << bookGroup.find(tmpLog.offset).name.name;
+                std::cout << book.name.name;
             }
-            std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+            std::cout << " (ISBN=" << book.isbn.isbn
                       << ")" << std::endl;
         } else if (tmpLog.behaviour == Log::login) {
             std::cout << "[" << tmpLog.userID.ID << "]\tlogin" << std::endl;
@@ -247,31 +238,31 @@ void LogGroup::showLog(TokenScanner& line, const LoggingSituation& loggingStatus
 
 void LogGroup::_reportFinance(BookGroup& bookGroup)
 {
-    _logs.seekp(0, std::ios::end);
-    const int end = _logs.tellp();
-    _logs.seekg(0);
+    const offset_t end = _logs.size();
     Log tmpLog;
-    for (int i = 0; i < end; i += sizeof(Log)) {
-        _logs.read(reinterpret_cast<char*>(&tmpLog), sizeof(Log));
+    for (offset_t i = 0; i < end; i += sizeof(Log)) {
+        scanRecord(_logs, i, tmpLog);
+        if (tmpLog.behaviour != Log::buy && tmpLog.behaviour != Log::import) continue;
+        const Book book = bookGroup.find(tmpLog.offset);
         if (tmpLog.behaviour == Log::buy) {
             std::cout << "+" << std::fixed << std::setprecision(2) << tmpLog.sum << "\t(["
                       << tmpLog.userID.ID << "] bought  : " << tmpLog.quantity << " ";
-            if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+            if (book.name.name[0] == '\0') {
                 std::cout << "< blank name >";
             } else {
-                std::cout << bookGroup.find(tmpLog.offset).name.name;
+                std::cout << book.name.name;
             }
-            std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+            std::cout << " (ISBN=" << book.isbn.isbn
                       << "))" << std::endl;
         } else if (tmpLog.behaviour == Log::import) {
             std::cout << "-" << std::fixed << std::setprecision(2) << tmpLog.sum << "\t(["
                       << tmpLog.userID.ID << "] imported: " << tmpLog.quantity << " ";
-            if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+            if (book.name.name[0] == '\0') {
                 std::cout << " < blank name >";
             } else {
-                std::cout << bookGroup.find(tmpLog.offset).name.name;
+                std::cout << book.name.name;
             }
-            std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+            std::cout << " (ISBN=" << book.isbn.isbn
                       << "))" << std::endl;
         }
     }
@@ -279,52 +270,51 @@ void LogGroup::_reportFinance(BookGroup& bookGroup)
 
 void LogGroup::_reportEmployee(AccountGroup& accounts, BookGroup& bookGroup)
 {
-    _logs.seekp(0, std::ios::end);
-    const int end = _logs.tellp();
-    _logs.seekg(0);
+    const offset_t end = _logs.size();
     Log tmpLog;
-    for (int i = 0; i < end; i += sizeof(Log)) {
-        _logs.read(reinterpret_cast<char*>(&tmpLog), sizeof(Log));
+    for (offset_t i = 0; i < end; i += sizeof(Log)) {
+        scanRecord(_logs, i, tmpLog);
         if (tmpLog.priority == 3) {
+            const Book book = aboutBook(tmpLog) ? bookGroup.find(tmpLog.offset) : Book();
             if (tmpLog.behaviour == Log::buy) {
                 std::cout << "[" << tmpLog.userID.ID << "]\tbought  : "
                           << tmpLog.quantity << " ";
-                if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                if (book.name.name[0] == '\0') {
                     std::cout << "< blank name >";
                 } else {
-                    std::cout << bookGroup.find(tmpLog.offset).name.name;
+                    std::cout << book.name.name;
                 }
-                std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                std::cout << " (ISBN=" << book.isbn.isbn
                           << ") with $" << std::fixed << std::setprecision(2)
                           << tmpLog.sum << std::endl;
             } else if (tmpLog.behaviour == Log::modify) {
                 std::cout << "[" << tmpLog.userID.ID << "]\tmodified: ";
-                if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                if (book.name.name[0] == '\0') {
                     std::cout << "< blank name >";
                 } else {
-                    std::cout << bookGroup.find(tmpLog.offset).name.name;
+                    std::cout << book.name.name;
                 }
-                std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                std::cout << " (ISBN=" << book.isbn.isbn
                           << ") " << tmpLog.description << std::endl;
             } else if (tmpLog.behaviour == Log::import) {
                 std::cout << "[" << tmpLog.userID.ID << "]\timported: "
                           << tmpLog.quantity << " ";
-                if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                if (book.name.name[0] == '\0') {
                     std::cout << "< blank name >";
                 } else {
-                    std::cout << bookGroup.find(tmpLog.offset).name.name;
+                    std::cout << book.name.name;
                 }
-                std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                std::cout << " (ISBN=" << book.isbn.isbn
                           << ") with $" << std::fixed << std::setprecision(2)
                           << tmpLog.sum << std::endl;
             } else if (tmpLog.behaviour == Log::create) {
                 std::cout << "[" << tmpLog.userID.ID << "]\tcreated : ";
-                if (bookGroup.find(tmpLog.offset).name.name[0] == '\0') {
+                if (book.name.name[0] == '\0') {
                     std::cout << "< blank name >";
                 } else {
-                    std::cout << bookGroup.find(tmpLog.offset).name.name;
+                    std::cout << book.name.name;
                 }
-                std::cout << " (ISBN=" << bookGroup.find(tmpLog.offset).isbn.isbn
+                std::cout << " (ISBN=" << book.isbn.isbn
                           << ")" << std::endl;
             } else if (tmpLog.behaviour == Log::login) {
                 std::cout << "[" << tmpLog.userID.ID << "]\tlogin" << std::endl;
@@ -342,11 +332,11 @@ void LogGroup::_reportEmployee(AccountGroup& accounts, BookGroup& bookGroup)
 }
 
 Log::Log(Behaviour behaviourIn, double sumIn, int quantityIn, bool flagIn, const UserID& userIDIn,
-         int offsetIn, const string_t& descriptionIn, int priorityIn)
+         offset_t offsetIn, const string_t& descriptionIn, int priorityIn)
          : behaviour(behaviourIn), sum(sumIn), quantity(quantityIn), flag(flagIn),
            userID(userIDIn), offset(offsetIn), priority(priorityIn)
 {
-    for (int i = 0; i < descriptionIn.length(); ++i) {
+    for (size_t i = 0; i < descriptionIn.length(); ++i) {
         description[i] = descriptionIn[i];
     }
     description[descriptionIn.size()] = '\0';
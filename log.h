@@ -25,7 +25,7 @@ struct Log {
 
     UserID userID;
 
-    int offset;
+    offset_t offset;
 
     char description[200];
 
@@ -34,21 +34,21 @@ struct Log {
     Log() = default;
 
     Log(Behaviour behaviourIn, double sumIn, int quantityIn, bool flagIn, const UserID& userIDIn,
-        int offsetIn, const string_t& descriptionIn, int priorityIn);
+        offset_t offsetIn, const string_t& descriptionIn, int priorityIn);
 };
 
 class LogGroup {
 private:
-    std::fstream _logs;
+    StorageFile _logs = StorageFile("log");
 
-    std::fstream _finance_logs;
+    StorageFile _finance_logs = StorageFile("finance_log");
 
     void _reportFinance(BookGroup& bookGroup);
 
     void _reportEmployee(AccountGroup& accounts, BookGroup& bookGroup);
 
 public:
-    LogGroup();
+    LogGroup() = default;
 
     ~LogGroup() = default;
 
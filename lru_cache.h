@@ -0,0 +1,251 @@
+#ifndef LRU_CACHE
+#define LRU_CACHE
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @class LRUCache
+ *
+ * This is a cache of a fixed number of slots, which are all allocated
+ * when it is constructed, so that nothing is allocated when an entry is
+ * looked up, put in or dropped.  The slots are linked in the order of
+ * their uses, and a chained hash table finds the slot of a key, where
+ * all the links are the indexes of the slots kept in the slots.
+ * <br><br>
+ * An entry is referred to by the index of its slot, which stays the same
+ * until the entry is erased, and so does the address of its value.  The
+ * values are default-initialized once, so a slot reused for another key
+ * keeps the old value until it is assigned.
+ * <br><br>
+ * WARNING: the cache is not guarded by a lock.
+ */
+template <class keyType, class valueType, class hashType = std::hash<keyType>>
+class LRUCache {
+public:
+    static constexpr int none = -1;
+
+private:
+    struct _slot {
+        keyType key;
+
+        int newer; // the slot used after it (none for the most recently used one)
+
+        int older;
+
+        int next; // the next slot in the same bucket (or the next free slot)
+    };
+
+    std::vector<_slot> _slots;
+
+    std::unique_ptr<valueType[]> _values; // (not filled for the types without constructors)
+
+    std::vector<int> _buckets; // the first slot of each bucket
+
+    int _shift; // the bits of a hash dropped to get its bucket
+
+    int _newest = none;
+
+    int _oldest = none;
+
+    int _free = 0; // the first free slot
+
+    size_t _size = 0;
+
+    [[nodiscard]] size_t _bucket_of(const keyType& key) const
+    {
+        // (the hashes of the integers are themselves, so they are mixed first)
+        return static_cast<size_t>((static_cast<std::uint64_t>(hashType()(key)) * 0x9e3779b97f4a7c15ULL) >> _shift);
+    }
+
+    void _unlink(int slot)
+    {
+        _slot& current = _slots[slot];
+        if (current.newer == none) _newest = current.older;
+        else _slots[current.newer].older = current.older;
+        if (current.older == none) _oldest = current.newer;
+        else _slots[current.older].newer = current.newer;
+    }
+
+    void _link_newest(int slot)
+    {
+        _slot& current = _slots[slot];
+        current.newer = none;
+        current.older = _newest;
+        if (_newest == none) _oldest = slot;
+        else _slots[_newest].newer = slot;
+        _newest = slot;
+    }
+
+public:
+    /**
+     * @param capacity the number of slots (at least 1)
+     */
+    explicit LRUCache(size_t capacity)
+    : _slots(capacity == 0 ? 1 : capacity), _values(new valueType[_slots.size()])
+    {
+        size_t bucketCount = 1;
+        _shift = 64;
+        while (bucketCount < _slots.size()) {
+            bucketCount *= 2;
+            --_shift;
+        }
+        if (_shift == 64) { // (a shift by 64 is undefined)
+            bucketCount = 2;
+            _shift = 63;
+        }
+        _buckets.assign(bucketCount, none);
+        clear();
+    }
+
+    LRUCache(LRUCache&&) noexcept = default;
+
+    LRUCache& operator=(LRUCache&&) noexcept = default;
+
+    /**
+     * This function returns the slot of a key without changing the
+     * order of the uses.
+     * @param key
+     * @return the slot, or none if the key is not in the cache
+     */
+    [[nodiscard]] int find(const keyType& key) const
+    {
+        for (int slot = _buckets[_bucket_of(key)]; slot != none; slot = _slots[slot].next) {
+            if (_slots[slot].key == key) return slot;
+        }
+        return none;
+    }
+
+    /**
+     * This function makes an entry the most recently used one.
+     * @param slot
+     */
+    void touch(int slot)
+    {
+        if (slot == _newest) return;
+        _unlink(slot);
+        _link_newest(slot);
+    }
+
+    /**
+     * This function puts a key into a free slot as the most recently used
+     * entry.  Its value is left as it was.
+     * <br><br>
+     * WARNING: the key MUST NOT be in the cache, and the cache MUST NOT
+     * be full.
+     * @param key
+     * @return the slot
+     */
+    int insert(const keyType& key)
+    {
+        const int slot = _free;
+        _free = _slots[slot].next;
+        const size_t bucket = _bucket_of(key);
+        _slots[slot].key = key;
+        _slots[slot].next = _buckets[bucket];
+        _buckets[bucket] = slot;
+        _link_newest(slot);
+        ++_size;
+        return slot;
+    }
+
+    /**
+     * This function returns the slot of a key, and puts the key into the
+     * cache if it is not there, dropping the least recently used entry if
+     * the cache is full.  The entry becomes the most recently used one.
+     * @param key
+     * @param inserted set to whether the key was not in the cache
+     * @return the slot
+     */
+    int put(const keyType& key, bool& inserted)
+    {
+        int slot = find(key);
+        inserted = (slot == none);
+        if (!inserted) {
+            touch(slot);
+            return slot;
+        }
+        if (full()) erase(_oldest);
+        return insert(key);
+    }
+
+    /**
+     * This function drops an entry.
+     * @param slot
+     */
+    void erase(int slot)
+    {
+        int* link = &_buckets[_bucket_of(_slots[slot].key)];
+        while (*link != slot) link = &_slots[*link].next;
+        *link = _slots[slot].next;
+        _unlink(slot);
+        _slots[slot].next = _free;
+        _free = slot;
+        --_size;
+    }
+
+    /**
+     * This function drops all the entries.
+     */
+    void clear()
+    {
+        std::fill(_buckets.begin(), _buckets.end(), none);
+        for (size_t i = 0; i < _slots.size(); ++i) {
+            _slots[i].next = (i + 1 == _slots.size()) ? none : static_cast<int>(i + 1);
+        }
+        _free = 0;
+        _newest = _oldest = none;
+        _size = 0;
+    }
+
+    /**
+     * These functions go through the entries from the least recently used
+     * one.  The entry after the current one MUST be taken before the
+     * current one is erased.
+     */
+    [[nodiscard]] int oldest() const
+    {
+        return _oldest;
+    }
+
+    [[nodiscard]] int newer(int slot) const
+    {
+        return _slots[slot].newer;
+    }
+
+    [[nodiscard]] const keyType& key(int slot) const
+    {
+        return _slots[slot].key;
+    }
+
+    valueType& value(int slot)
+    {
+        return _values[slot];
+    }
+
+    const valueType& value(int slot) const
+    {
+        return _values[slot];
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return _size;
+    }
+
+    [[nodiscard]] size_t capacity() const
+    {
+        return _slots.size();
+    }
+
+    [[nodiscard]] bool full() const
+    {
+        return _size == _slots.size();
+    }
+};
+
+#endif //LRU_CACHE
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+// the least size of a mapping
+constexpr offset_t minimumCapacity = 1 << 20;
+
+MappedFile::MappedFile(const std::string& fileName)
+{
+    _descriptor = openFile(fileName);
+    _size = lseek(_descriptor, 0, SEEK_END);
+    if (_size < 0) stopOnFailure("seek");
+    _remap(_size);
+}
+
+MappedFile::~MappedFile()
+{
+    flush();
+    munmap(_data, _capacity);
+    close(_descriptor);
+}
+
+void MappedFile::_remap(offset_t capacity)
+{
+    offset_t newCapacity = std::max(_capacity, minimumCapacity);
+    while (newCapacity < capacity) newCapacity *= 2;
+    if (_data != nullptr) {
+        if (newCapacity == _capacity) return;
+        if (munmap(_data, _capacity) != 0) stopOnFailure("munmap");
+    }
+    void* data = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, _descriptor, 0);
+    if (data == MAP_FAILED) stopOnFailure("mmap");
+    _data = static_cast<char*>(data);
+    _capacity = newCapacity;
+}
+
+void MappedFile::_set_size(offset_t size)
+{
+    truncateTo(_descriptor, size);
+    _size = size;
+    if (_size > _capacity) _remap(_size);
+}
+
+void MappedFile::read(offset_t position, char* target, offset_t length)
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    // the part beyond the end of the file is read as zeros
+    offset_t count = std::max<offset_t>(std::min(length, _size - position), 0);
+    std::memcpy(target, _data + position, count);
+    std::memset(target + count, 0, length - count);
+}
+
+void MappedFile::write(offset_t position, const char* source, offset_t length)
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    if (position + length > _size) {
+        lock.unlock();
+        std::unique_lock<std::shared_mutex> resizeLock(_mutex);
+        if (position + length > _size) _set_size(position + length);
+        std::memcpy(_data + position, source, length);
+        return;
+    }
+    std::memcpy(_data + position, source, length);
+}
+
+offset_t MappedFile::size() const
+{
+    return _size;
+}
+
+void MappedFile::resize(offset_t size)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    _set_size(size);
+}
+
+void MappedFile::prefetch(offset_t position, offset_t length)
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    static const offset_t pageSize = sysconf(_SC_PAGESIZE);
+    offset_t begin = position / pageSize * pageSize;
+    offset_t end = std::min(position + length, _size);
+    if (begin < end) madvise(_data + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::flush()
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    if (_size > 0 && msync(_data, _size, MS_ASYNC) != 0) stopOnFailure("msync");
+}
@@ -0,0 +1,99 @@
+#ifndef MAPPED_FILE
+#define MAPPED_FILE
+
+#include <shared_mutex>
+#include <string>
+
+#include "buffer_pool.h"
+
+/**
+ * @class MappedFile
+ *
+ * This is a file on disk that is mapped into the memory, so that reading
+ * and writing it are only copies in the memory.  It has the same interface
+ * as CachedFile.  More space than the file is mapped, and the mapping is
+ * made larger only when the file grows beyond it.  The copies can be made
+ * by several threads at a time, but not while the file is resized.
+ * <br><br>
+ * WARNING: the file MUST exist before it is opened.
+ */
+class MappedFile {
+private:
+    int _descriptor = -1;
+
+    char* _data = nullptr; // the beginning of the mapping
+
+    offset_t _size = 0; // the size of the file
+
+    offset_t _capacity = 0; // the size of the mapping
+
+    std::shared_mutex _mutex; // held alone to resize the file (and to map it again)
+
+    /**
+     * This function maps the file again with a size that is no less than
+     * the given one.
+     * @param capacity
+     */
+    void _remap(offset_t capacity);
+
+    /**
+     * This function changes the size of the file on disk, and makes the
+     * mapping larger if necessary.
+     * @param size
+     */
+    void _set_size(offset_t size);
+
+public:
+    explicit MappedFile(const std::string& fileName);
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile();
+
+    /**
+     * This function reads a string of stuff from the file.
+     * @param position the place to get the data
+     * @param target the place to put the data
+     * @param length
+     */
+    void read(offset_t position, char* target, offset_t length);
+
+    /**
+     * This function writes a string of stuff to the file.
+     * @param position the place to put the data
+     * @param source the source pointer
+     * @param length
+     */
+    void write(offset_t position, const char* source, offset_t length);
+
+    /**
+     * This function returns the size of the file.
+     */
+    [[nodiscard]] offset_t size() const;
+
+    /**
+     * This function changes the size of the file.  The data beyond the
+     * new size is discarded, and the new part (if any) is filled with
+     * zeros.
+     * @param size
+     */
+    void resize(offset_t size);
+
+    /**
+     * This function asks the system to read a part of the file ahead,
+     * without waiting for the disk.
+     * @param position
+     * @param length
+     */
+    void prefetch(offset_t position, offset_t length);
+
+    /**
+     * This function asks the system to write the changed pages back to
+     * the disk.
+     */
+    void flush();
+};
+
+#endif //MAPPED_FILE
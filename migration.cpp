@@ -0,0 +1,315 @@
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "account.h"
+#include "log.h"
+#include "book.h"
+#include "journal.h"
+#include "migration.h"
+
+// the version of the format of the data files written by this program
+const int dataVersion = 3;
+
+// the settings chosen at compile time that change the layout of the data
+// files, which are recorded after the version (front coding is only used
+// by the unrolled linked lists)
+const std::string dataFormat = std::string(
+#ifdef BOOKSTORE_BPLUS_TREE
+        "bplus_tree"
+#elif defined(BOOKSTORE_FRONT_CODING)
+        "unrolled_linked_list front_coding"
+#else
+        "unrolled_linked_list"
+#endif
+        ) + " offset" + std::to_string(8 * sizeof(offset_t));
+
+// the settings of the stores of the current version that were written
+// before the settings were recorded (with the default ones)
+const std::string unrecordedFormat = "unrolled_linked_list offset64";
+
+/// The following are the layouts of version 1, in which every offset is an int
+
+struct LegacyFirstNode {
+    int next;
+
+    int pre;
+
+    int nodeSize;
+
+    int maxNodeSize;
+};
+
+template <class keyType>
+struct LegacyMainNode {
+    keyType key;
+
+    int value;
+
+    int target;
+
+    int count;
+
+    int next;
+
+    int pre;
+};
+
+template <class keyType>
+struct LegacyNode {
+    keyType key;
+
+    int value;
+};
+
+template <class keyType1, class keyType2>
+struct LegacyDoubleMainNode {
+    keyType1 key1;
+
+    keyType2 key2;
+
+    int value;
+
+    int target;
+
+    int count;
+
+    int next;
+
+    int pre;
+};
+
+template <class keyType1, class keyType2>
+struct LegacyDoubleNode {
+    keyType1 key1;
+
+    keyType2 key2;
+
+    int value;
+};
+
+struct LegacyLog {
+    Log::Behaviour behaviour;
+
+    double sum;
+
+    int quantity;
+
+    bool flag;
+
+    UserID userID;
+
+    int offset;
+
+    char description[200];
+
+    int priority;
+};
+
+/**
+ * This function reads all the key-value pairs of an unrolled linked
+ * list of version 1 in order.
+ * @param fileName
+ * @return the key-value pairs
+ */
+template <class keyType>
+std::vector<LegacyNode<keyType>> readLegacyList(const std::string& fileName)
+{
+    std::vector<LegacyNode<keyType>> nodes;
+    std::ifstream list(fileName, std::ios::binary);
+    LegacyFirstNode head;
+    if (!list.read(reinterpret_cast<char*>(&head), sizeof(LegacyFirstNode))) return nodes; // an empty file
+
+    LegacyMainNode<keyType> mainNode;
+    int mainPtr = head.next;
+    while (mainPtr != 0) {
+        list.seekg(mainPtr);
+        list.read(reinterpret_cast<char*>(&mainNode), sizeof(mainNode));
+        nodes.push_back(LegacyNode<keyType>{mainNode.key, mainNode.value});
+        nodes.resize(nodes.size() + mainNode.count);
+        list.seekg(mainNode.target);
+        list.read(reinterpret_cast<char*>(nodes.data() + nodes.size() - mainNode.count),
+                  mainNode.count * sizeof(LegacyNode<keyType>));
+        mainPtr = mainNode.next;
+    }
+    return nodes;
+}
+
+/**
+ * This function reads all the key-value pairs of a double unrolled
+ * linked list of version 1 in order.
+ * @param fileName
+ * @return the key-value pairs
+ */
+template <class keyType1, class keyType2>
+std::vector<LegacyDoubleNode<keyType1, keyType2>> readLegacyDoubleList(const std::string& fileName)
+{
+    std::vector<LegacyDoubleNode<keyType1, keyType2>> nodes;
+    std::ifstream list(fileName, std::ios::binary);
+    LegacyFirstNode head;
+    if (!list.read(reinterpret_cast<char*>(&head), sizeof(LegacyFirstNode))) return nodes; // an empty file
+
+    LegacyDoubleMainNode<keyType1, keyType2> mainNode;
+    int mainPtr = head.next;
+    while (mainPtr != 0) {
+        list.seekg(mainPtr);
+        list.read(reinterpret_cast<char*>(&mainNode), sizeof(mainNode));
+        nodes.push_back(LegacyDoubleNode<keyType1, keyType2>{mainNode.key1, mainNode.key2, mainNode.value});
+        nodes.resize(nodes.size() + mainNode.count);
+        list.seekg(mainNode.target);
+        list.read(reinterpret_cast<char*>(nodes.data() + nodes.size() - mainNode.count),
+                  mainNode.count * sizeof(LegacyDoubleNode<keyType1, keyType2>));
+        mainPtr = mainNode.next;
+    }
+    return nodes;
+}
+
+/**
+ * This function rewrites an index of version 1 in the current format.
+ * The new index is built in the container, and the old file is kept
+ * until all of them are converted.
+ * @param fileName
+ */
+template <class keyType>
+void migrateIndex(const std::string& fileName)
+{
+    if (!std::filesystem::exists(fileName)) return; // converted before the last crash
+    std::vector<LegacyNode<keyType>> nodes = readLegacyList<keyType>(fileName);
+    Container::instance().remove(fileName);
+    Index<keyType, offset_t> index(fileName);
+    std::vector<std::pair<keyType, offset_t>> pairs;
+    for (const LegacyNode<keyType>& node : nodes) {
+        pairs.emplace_back(node.key, node.value);
+    }
+    index.bulkLoad(pairs.begin(), pairs.end());
+}
+
+/**
+ * This function rewrites an index with two keys of version 1 in the
+ * current format.  The new index is built in the container, and the old
+ * file is kept until all of them are converted.
+ * @param fileName
+ */
+template <class keyType1, class keyType2>
+void migrateDoubleIndex(const std::string& fileName)
+{
+    if (!std::filesystem::exists(fileName)) return; // converted before the last crash
+    std::vector<LegacyDoubleNode<keyType1, keyType2>> nodes = readLegacyDoubleList<keyType1, keyType2>(fileName);
+    Container::instance().remove(fileName);
+    DoubleIndex<keyType1, keyType2, offset_t> index(fileName);
+    std::vector<std::tuple<keyType1, keyType2, offset_t>> tuples;
+    for (const LegacyDoubleNode<keyType1, keyType2>& node : nodes) {
+        tuples.emplace_back(node.key1, node.key2, node.value);
+    }
+    index.bulkLoad(tuples.begin(), tuples.end());
+}
+
+/**
+ * This function rewrites the log of version 1 in the current format.
+ * Just like the indexes, the new log is built in the container, and the
+ * old file is kept until all of them are converted, so that the log is
+ * never converted twice.
+ */
+void migrateLog()
+{
+    if (!std::filesystem::exists("log")) return; // converted before the last crash
+    std::ifstream oldLogs("log", std::ios::binary);
+    StorageFile newLogs("log");
+    newLogs.resize(0);
+    LegacyLog oldLog;
+    offset_t position = 0;
+    while (oldLogs.read(reinterpret_cast<char*>(&oldLog), sizeof(LegacyLog))) {
+        Log newLog(oldLog.behaviour, oldLog.sum, oldLog.quantity, oldLog.flag, oldLog.userID,
+                   oldLog.offset, string_t(oldLog.description), oldLog.priority);
+        newLogs.write(position, reinterpret_cast<const char*>(&newLog), sizeof(Log));
+        position += sizeof(Log);
+    }
+}
+
+/**
+ * This function copies a data file of version 2 into the container with
+ * the same name.  The file on disk is kept.
+ * @param fileName
+ */
+void importFile(const std::string& fileName)
+{
+    if (!std::filesystem::exists(fileName)) return;
+    std::ifstream source(fileName, std::ios::binary);
+    StorageFile target(fileName);
+    target.resize(0);
+    std::vector<char> buffer(1 << 20);
+    offset_t position = 0;
+    while (source.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || source.gcount() > 0) {
+        target.write(position, buffer.data(), source.gcount());
+        position += source.gcount();
+    }
+}
+
+/**
+ * This function records the version of the format of the data files,
+ * and the settings of this build that change the layout.
+ * @param version
+ */
+void writeVersion(int version)
+{
+    std::ofstream versionWriter("version");
+    versionWriter << version << std::endl << dataFormat << std::endl;
+}
+
+void migrate()
+{
+    int version = 1; // the files without a version are of version 1
+    std::string format;
+    std::ifstream versionReader("version");
+    if (versionReader.good()) versionReader >> version >> std::ws;
+    std::getline(versionReader, format);
+    versionReader.close();
+    if (version >= dataVersion) {
+        if (format.empty()) format = unrecordedFormat;
+        if (format != dataFormat) {
+            throw std::runtime_error("the data files were written by a build with \"" + format +
+                                     "\", which cannot be read by this build with \"" + dataFormat + "\"");
+        }
+        return;
+    }
+
+#ifndef BOOKSTORE_MMAP
+    // replay the commands committed to the old files before the last crash (if any)
+    Journal::instance().open("journal");
+    Journal::instance().close();
+#endif
+    Container& container = Container::instance();
+    container.open(Container::defaultName);
+
+    const std::vector<std::string> indexes = {"account_index", "book_index_ISBN", "book_index_name",
+                                              "book_index_author", "book_index_keyword"};
+    // there is nothing to convert if the program has never been run
+    if (version < 2 && std::filesystem::exists("account")) {
+        migrateIndex<UserID>("account_index");
+        migrateIndex<ISBN>("book_index_ISBN");
+        migrateDoubleIndex<Name, ISBN>("book_index_name");
+        migrateDoubleIndex<Author, ISBN>("book_index_author");
+        migrateDoubleIndex<Keyword, ISBN>("book_index_keyword");
+        migrateLog();
+        container.flush();
+        // (the converted files are removed only after all of them are in the container)
+        for (const std::string& index : indexes) std::filesystem::remove(index);
+        std::filesystem::remove("log");
+    }
+    if (version < 2) writeVersion(2);
+
+    // every data file of version 2 is a file on disk, which is moved into the container
+    std::vector<std::string> files = {"account", "book", "log", "finance_log"};
+    for (const std::string& index : indexes) {
+        files.push_back(index);
+        files.push_back(index + "_buffer");
+        files.push_back(index + "_bloom");
+    }
+    for (const std::string& file : files) importFile(file);
+    container.close();
+    writeVersion(dataVersion);
+    for (const std::string& file : files) std::filesystem::remove(file);
+}
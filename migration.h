@@ -0,0 +1,20 @@
+#ifndef MIGRATION
+#define MIGRATION
+
+/**
+ * This function converts the data files written by an older version of
+ * the program into the current format, moves them into the container,
+ * and records the version of the format in the file "version".  It does
+ * nothing for the files that are already up to date.
+ * <br><br>
+ * The settings chosen at compile time that change the layout of the data
+ * files (such as the engine of the indexes) are recorded with the
+ * version.  If the files are written by a build with other settings, it
+ * throws std::runtime_error without opening any of them.
+ * <br><br>
+ * WARNING: it MUST be called before the journal and the container are
+ * opened.
+ */
+void migrate();
+
+#endif //MIGRATION
@@ -0,0 +1,38 @@
+#ifndef STORAGE_ENGINE
+#define STORAGE_ENGINE
+
+// The engine of the indexes is chosen at compile time: define
+// BOOKSTORE_BPLUS_TREE to use the B+ tree instead of the unrolled
+// linked list.  The files written by one engine cannot be read by
+// the other one, so the engine is recorded with the data files, and a
+// build with the other engine refuses them (see migrate()).
+
+#ifdef BOOKSTORE_BPLUS_TREE
+
+#include "bplus_tree.h"
+
+template <class keyType, class valueType>
+using Index = BPlusTree<keyType, valueType>;
+
+template <class keyType1, class keyType2, class valueType>
+using DoubleIndex = DoubleBPlusTree<keyType1, keyType2, valueType>;
+
+template <class valueType, class... keyTypes>
+using CompositeIndex = CompositeBPlusTree<valueType, keyTypes...>;
+
+#else
+
+#include "unrolled_linked_list.h"
+
+template <class keyType, class valueType>
+using Index = UnrolledLinkedList<keyType, valueType>;
+
+template <class keyType1, class keyType2, class valueType>
+using DoubleIndex = DoubleUnrolledLinkedList<keyType1, keyType2, valueType>;
+
+template <class valueType, class... keyTypes>
+using CompositeIndex = CompositeUnrolledLinkedList<valueType, keyTypes...>;
+
+#endif
+
+#endif //STORAGE_ENGINE
@@ -0,0 +1,12 @@
+#ifndef STORAGE_FILE
+#define STORAGE_FILE
+
+// All the data files are named files in the container, which is read
+// through the buffer pool, or mapped into the memory if BOOKSTORE_MMAP
+// is defined at compile time.  Both of them use the same format.
+
+#include "container.h"
+
+typedef ContainerFile StorageFile;
+
+#endif //STORAGE_FILE
@@ -0,0 +1,197 @@
+// This test runs a writer and several readers on an index at a time.
+// The writer inserts the keys in a random order and then erases them in
+// another one, while each reader looks them up one by one and in batches
+// and scans the index with cursors, checking that every key written
+// before a lookup or a scan began is seen by it, and that every key
+// erased before is not.  It is run with and without the write buffer.
+// Since the lock prefers the writers, the writer finishes while the
+// readers keep scanning.
+//
+// Usage: ConcurrencyTest [number of keys] [number of readers]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../storage_engine.h"
+
+/**
+ * @struct Key
+ *
+ * This is a key of a fixed size, just like the ISBNs of the program.
+ */
+struct Key {
+    char text[16];
+
+    Key() : text{} {}
+
+    explicit Key(int number) : text{}
+    {
+        std::snprintf(text, sizeof(text), "key%08d", number);
+    }
+
+    bool operator==(const Key& rhs) const
+    {
+        return std::strcmp(text, rhs.text) == 0;
+    }
+
+    bool operator<(const Key& rhs) const
+    {
+        return std::strcmp(text, rhs.text) < 0;
+    }
+};
+
+std::mutex failureMutex;
+
+int failureCount = 0;
+
+/**
+ * This function reports a failure (only the first few of them are printed).
+ * @param message
+ */
+void fail(const std::string& message)
+{
+    std::lock_guard<std::mutex> lock(failureMutex);
+    if (++failureCount <= 10) std::cout << message << std::endl;
+}
+
+/**
+ * This function runs the writer and the readers on a new index.
+ * @param keyCount
+ * @param readerCount
+ * @param bufferCapacity the capacity of the write buffer (0 to write to the index directly)
+ */
+void runIndex(int keyCount, int readerCount, size_t bufferCapacity)
+{
+    const std::string fileName = "concurrency_test_index";
+    Container::instance().remove(fileName);
+    Container::instance().remove(fileName + "_buffer");
+    Index<Key, int> index(fileName);
+    index.setBufferCapacity(bufferCapacity);
+
+    // the orders of the insertions and the erasures, and how many of them are done
+    std::vector<int> insertOrder(keyCount), eraseOrder(keyCount);
+    for (int i = 0; i < keyCount; ++i) insertOrder[i] = eraseOrder[i] = i;
+    std::mt19937 random(2021);
+    std::shuffle(insertOrder.begin(), insertOrder.end(), random);
+    std::shuffle(eraseOrder.begin(), eraseOrder.end(), random);
+    std::vector<int> insertedAt(keyCount), erasedAt(keyCount); // the places of the keys in the orders
+    for (int i = 0; i < keyCount; ++i) {
+        insertedAt[insertOrder[i]] = i;
+        erasedAt[eraseOrder[i]] = i;
+    }
+    std::atomic<int> inserted(0), erasing(0), erased(0); // (an erasure is counted by erasing when it begins)
+    std::atomic<bool> writing(true);
+
+    std::thread writer([&]() {
+        for (int number : insertOrder) {
+            index.insert(Key(number), number);
+            ++inserted;
+        }
+        for (int number : eraseOrder) {
+            ++erasing;
+            index.erase(Key(number));
+            ++erased;
+        }
+        writing = false;
+    });
+
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < readerCount; ++reader) {
+        readers.emplace_back([&, reader]() {
+            std::mt19937 readerRandom(reader);
+            while (writing) {
+                // (a key inserted before the lookup began and not erased yet is there)
+                const int number = static_cast<int>(readerRandom() % keyCount);
+                const int insertedBefore = inserted, erasedBefore = erased;
+                std::optional<int> value = index.get(Key(number));
+                const int erasingAfter = erasing;
+                if (insertedAt[number] < insertedBefore && erasedAt[number] >= erasingAfter && value != number) {
+                    fail("the key " + std::to_string(number) + " is not found");
+                }
+                if (erasedAt[number] < erasedBefore && value.has_value()) {
+                    fail("the erased key " + std::to_string(number) + " is found");
+                }
+
+                // The same for a batch of keys looked up at a time
+                std::vector<int> numbers;
+                std::vector<Key> keys;
+                for (int i = 0; i < 16; ++i) {
+                    numbers.push_back(static_cast<int>(readerRandom() % keyCount));
+                    keys.emplace_back(numbers.back());
+                }
+                const int batchInserted = inserted, batchErased = erased;
+                std::vector<std::optional<int>> values = index.multiGet(keys);
+                const int batchErasingAfter = erasing;
+                for (size_t i = 0; i < numbers.size(); ++i) {
+                    const int batchNumber = numbers[i];
+                    if (insertedAt[batchNumber] < batchInserted && erasedAt[batchNumber] >= batchErasingAfter &&
+                        values[i] != batchNumber) {
+                        fail("the key " + std::to_string(batchNumber) + " is not found in a batch");
+                    }
+                    if (erasedAt[batchNumber] < batchErased && values[i].has_value()) {
+                        fail("the erased key " + std::to_string(batchNumber) + " is found in a batch");
+                    }
+                }
+
+                // The same for a scan of the whole index
+                const int scanInserted = inserted, scanErased = erased;
+                std::vector<bool> seen(keyCount, false);
+                Key last;
+                bool first = true;
+                for (auto cursor = index.cursor(); cursor.hasNext();) {
+                    const int found = cursor.next();
+                    if (found < 0 || found >= keyCount || (!first && !(last < Key(found)))) {
+                        fail("the scan is out of order at " + std::to_string(found));
+                        break;
+                    }
+                    seen[found] = true;
+                    last = Key(found);
+                    first = false;
+                }
+                const int scanErasingAfter = erasing;
+                for (int i = 0; i < keyCount; ++i) {
+                    if (insertedAt[i] < scanInserted && erasedAt[i] >= scanErasingAfter && !seen[i]) {
+                        fail("the key " + std::to_string(i) + " is missed by a scan");
+                    }
+                    if (erasedAt[i] < scanErased && seen[i]) {
+                        fail("the erased key " + std::to_string(i) + " is seen by a scan");
+                    }
+                }
+            }
+        });
+    }
+
+    writer.join();
+    for (std::thread& reader : readers) reader.join();
+    if (index.cursor().hasNext()) fail("the index is not empty at last");
+}
+
+int main(int argc, char** argv)
+{
+    const int keyCount = (argc > 1) ? std::atoi(argv[1]) : 20000;
+    const int readerCount = (argc > 2) ? std::atoi(argv[2]) : 3;
+    const std::string containerName = "concurrency_test_database";
+    std::remove(containerName.c_str());
+    Container::instance().open(containerName);
+
+    runIndex(keyCount, readerCount, 0);
+    runIndex(keyCount, readerCount, 256);
+
+    Container::instance().close();
+    std::remove(containerName.c_str());
+    if (failureCount != 0) {
+        std::cout << failureCount << " failures" << std::endl;
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
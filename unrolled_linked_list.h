@@ -1,29 +1,74 @@
 #ifndef UNROLLED_LINKED_LIST
 #define UNROLLED_LINKED_LIST
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include "composite_key.h"
+#include "fair_shared_mutex.h"
+#include "front_coding.h"
+#include "lru_cache.h"
+#include "storage_file.h"
+
+#ifdef BOOKSTORE_BLOOM_FILTER
+#include "bloom_filter.h"
+#endif
+
 /**
- * @class UnrolledLinkedList
+ * @class CompositeUnrolledLinkedList
  *
- * This is a template class of double unrolled linked list on disk.
+ * This is a template class of unrolled linked list on disk, whose key is
+ * made of one or more fields (see CompositeKey).  The key-value pairs
+ * are sorted by the whole key, and the ones whose leading fields are
+ * given can be traversed in order.
  * <br><br>
- * WARNING: the key type MUST have valid operator< and operator== !
- * @tparam keyType Type of Key
+ * The list is guarded by a reader-writer lock, so any number of threads
+ * can look it up at a time, while a modification keeps all the others
+ * out.  The readers never write: they see the writes in the write buffer
+ * beside the main nodes, and only keep clean main nodes in the cache.
+ * <br><br>
+ * WARNING: the key types MUST have valid operator< and operator== !
+ *
  * @tparam valueType Type of Value
+ * @tparam keyTypes Types of the fields of the key
  */
-template <class keyType, class valueType>
-class UnrolledLinkedList {
+template <class valueType, class... keyTypes>
+class CompositeUnrolledLinkedList {
 private:
-    typedef int ptr;
+    typedef offset_t ptr;
+
+    typedef CompositeKeyTraits<valueType, keyTypes...> _traits;
+
+    typedef CompositeKey<keyTypes...> _key;
+
+    static constexpr size_t _key_count = sizeof...(keyTypes);
 
-    std::fstream _list;
+    StorageFile _list;
+
+#ifdef BOOKSTORE_BLOOM_FILTER
+    // the keys of the list, kept in the file "<fileName>_bloom" (nullptr for a key of several fields)
+    std::unique_ptr<BloomFilter> _bloom;
+#endif
+
+    FairSharedMutex _mutex; // shared by the readers, and unique for the writers
+
+    unsigned long _version = 0; // changed whenever the main nodes are changed
 
     /// The following are private components of this linked list
 
     /**
-     * @struct _first_node{next, pre, nodeSize, maxNodeSize}
+     * @struct _first_node{next, pre, free, nodeSize, maxNodeSize}
      *
      * This is the node to pointer to the data, and metadata of the list
      */
@@ -32,11 +77,15 @@ private:
 
         ptr pre; // the last main node
 
+        ptr free; // the first free main node (the free ones are linked by next)
+
         int nodeSize;
 
         int maxNodeSize;
     } _head;
 
+    int _min_size; // a main node with fewer key-value pairs is merged or rebalanced
+
     /**
      * @struct _main_node{key, value, target, count, next, pre}
      *
@@ -44,7 +93,7 @@ private:
      * link other main nodes.
      */
     struct _main_node {
-        keyType key;
+        _key key;
 
         valueType value;
 
@@ -63,11 +112,386 @@ private:
      * This is the Node to store data.
      */
     struct _node {
-        keyType key;
+        _key key;
 
         valueType value;
     } _empty_node;
 
+    /**
+     * @struct _directory_entry{key, target}
+     *
+     * This is the in-memory copy of the key of a main node, so that
+     * the main node to search can be found without reading the disk.
+     */
+    struct _directory_entry {
+        _key key;
+
+        ptr target;
+    };
+
+    // the keys of all the main nodes (in the order of the list)
+    std::vector<_directory_entry> _directory;
+
+    /**
+     * @struct _cached_main_node{mainNode, dirty}
+     *
+     * This is the in-memory copy of a main node that has been read or
+     * written since the last write-back.
+     */
+    struct _cached_main_node {
+        _main_node mainNode;
+
+        bool dirty;
+    };
+
+    static constexpr size_t _main_cache_size = 256; // the number of main nodes kept before they are written back
+
+    typedef LRUCache<ptr, _cached_main_node> _main_cache_type;
+
+    _main_cache_type _main_cache = _main_cache_type(_main_cache_size);
+
+    std::mutex _cache_mutex; // the readers share the main node cache
+
+    bool _head_dirty = false; // whether the head has been changed since the last write-back
+
+    /**
+     * This function puts a main node into the main node cache.  If the
+     * cache is full, the clean main nodes are dropped at first, and if
+     * it is still full, a clean main node is not kept, while the cache is
+     * written back for a changed one.
+     * <br><br>
+     * A clean main node is put by the readers, so the cache is only
+     * written back under the lock for writing.
+     * @param target the place of the main node
+     * @param mainNode
+     * @param dirty whether the main node is changed
+     */
+    void _cache_main(ptr target, const _main_node& mainNode, bool dirty)
+    {
+        int slot = _main_cache.find(target);
+        if (slot == _main_cache_type::none) {
+            if (_main_cache.full()) {
+                for (int iter = _main_cache.oldest(); iter != _main_cache_type::none;) {
+                    const int next = _main_cache.newer(iter);
+                    if (!_main_cache.value(iter).dirty) _main_cache.erase(iter);
+                    iter = next;
+                }
+                if (_main_cache.full()) {
+                    if (!dirty) return;
+                    _write_back();
+                }
+            }
+            slot = _main_cache.insert(target);
+            _main_cache.value(slot).dirty = false;
+        }
+        _cached_main_node& cached = _main_cache.value(slot);
+        cached.mainNode = mainNode;
+        cached.dirty = cached.dirty || dirty;
+    }
+
+    /**
+     * This function reads a main node, from the main node cache if it is
+     * there.
+     * @param target the place of the main node
+     * @param mainNode the place to put the main node
+     */
+    void _read_main(ptr target, _main_node& mainNode)
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        const int slot = _main_cache.find(target);
+        if (slot != _main_cache_type::none) {
+            mainNode = _main_cache.value(slot).mainNode;
+            return;
+        }
+        _list.read(target, reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        _cache_main(target, mainNode, false);
+    }
+
+    /**
+     * This function writes a main node into the main node cache.  It is
+     * written into the file when the cache is written back, so a main
+     * node changed several times in a command is written only once.
+     * @param target the place of the main node
+     * @param mainNode
+     */
+    void _write_main(ptr target, const _main_node& mainNode)
+    {
+        std::lock_guard<std::mutex> lock(_cache_mutex);
+        _cache_main(target, mainNode, true);
+    }
+
+    /**
+     * This function writes the changed main nodes and the head into the
+     * file, and empties the main node cache.
+     */
+    void _write_back()
+    {
+        if (_head_dirty) {
+            _list.write(0, reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _head_dirty = false;
+        }
+        for (int slot = _main_cache.oldest(); slot != _main_cache_type::none; slot = _main_cache.newer(slot)) {
+            const _cached_main_node& cached = _main_cache.value(slot);
+            if (cached.dirty) {
+                _list.write(_main_cache.key(slot), reinterpret_cast<const char*>(&cached.mainNode), sizeof(_main_node));
+            }
+        }
+        _main_cache.clear();
+    }
+
+    /**
+     * This function returns the index of the last main node whose key
+     * is no greater than the given key.  If the key is less than any
+     * other keys, it will return 0 (the first main node).
+     * <br><br>
+     * WARNING: the list CANNOT be empty.
+     * @param key
+     * @return the index of the main node in the directory
+     */
+    size_t _search_directory(const _key& key) const
+    {
+        size_t leftIndex = 0, rightIndex = _directory.size();
+        while (leftIndex < rightIndex) {
+            size_t middle = (leftIndex + rightIndex) / 2;
+            if (key < _directory[middle].key) rightIndex = middle;
+            else leftIndex = middle + 1;
+        }
+        return (leftIndex == 0) ? 0 : leftIndex - 1;
+    }
+
+    /**
+     * This function reads all the main nodes to build the directory.
+     */
+    void _build_directory()
+    {
+        _directory.clear();
+        _main_node mainNode;
+        ptr mainPtr = _head.next;
+        while (mainPtr != 0) {
+            _read_main(mainPtr, mainNode);
+            _directory.push_back(_directory_entry{mainNode.key, mainPtr});
+            mainPtr = mainNode.next;
+        }
+    }
+
+    static constexpr size_t _read_ahead = 8; // the number of main nodes read ahead in a scan
+
+    /**
+     * This function asks the storage to read the main nodes after the
+     * index-th one of the directory (with their arrays) ahead in a scan,
+     * so that they are on the way while the current one is decoded.  They
+     * are read ahead in batches, and at least _read_ahead of them are on
+     * the way at a time.
+     * @param index the index of the main node being read
+     * @param prefetched the end of the main nodes read ahead before,
+     * which will be updated
+     */
+    void _read_ahead_from(size_t index, size_t& prefetched)
+    {
+        if (prefetched >= index + _read_ahead) return;
+        const size_t last = std::min(index + 2 * _read_ahead, _directory.size());
+        ptr begin = 0, end = 0; // the run of main nodes next to each other
+        for (size_t i = std::max(prefetched, index); i < last; ++i) {
+            if (_directory[i].target != end) {
+                if (end != begin) _list.prefetch(begin, end - begin);
+                begin = _directory[i].target;
+            }
+            end = _directory[i].target + sizeof(_main_node) + _array_space();
+        }
+        if (end != begin) _list.prefetch(begin, end - begin);
+        prefetched = std::max(prefetched, last);
+    }
+
+    // the buffer of the array of a main node (one for each thread)
+    inline static thread_local std::vector<_node> _block;
+
+#ifdef BOOKSTORE_FRONT_CODING
+    // the buffer of the front-coded array of a main node (one for each thread)
+    inline static thread_local std::vector<char> _code;
+
+    /**
+     * This function front codes an array into the code buffer.  The
+     * length of the code is put before the code.
+     * @param nodes
+     * @param count
+     */
+    void _encode(const _node* nodes, int count)
+    {
+        _code.resize(sizeof(int));
+        for (int i = 0; i < count; ++i) {
+            forEachField(nodes[i].key, (i == 0) ? nullptr : &nodes[i - 1].key,
+                         [](const auto& field, const auto* previous) { frontEncode(_code, field, previous); });
+            plainEncode(_code, nodes[i].value);
+        }
+        int length = static_cast<int>(_code.size() - sizeof(int));
+        std::memcpy(_code.data(), &length, sizeof(int));
+    }
+#endif
+
+    /**
+     * This function returns the space for the array of a main node.  With
+     * front coding, it is a quarter of the space of the plain array, and
+     * a main node is also split when its code doesn't fit into it.
+     */
+    [[nodiscard]] ptr _array_space() const
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        return std::max<ptr>((_head.maxNodeSize + 1) * sizeof(_node) / 4, 4 * (sizeof(_node) + 4) + sizeof(int));
+#else
+        return (_head.maxNodeSize + 1) * sizeof(_node);
+#endif
+    }
+
+    /**
+     * This function returns the number of bytes that a node takes in an array.
+     * @param node
+     * @param previous the node before it (nullptr for the first node of the array)
+     */
+    static ptr _entry_length([[maybe_unused]] const _node& node, [[maybe_unused]] const _node* previous)
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        ptr length = sizeof(valueType);
+        forEachField(node.key, (previous == nullptr) ? nullptr : &previous->key,
+                     [&length](const auto& field, const auto* previousField) {
+                         length += frontCodedLength(field, previousField);
+                     });
+        return length;
+#else
+        return sizeof(_node);
+#endif
+    }
+
+    /**
+     * This function tells whether an array fits into the space of a main node.
+     * @param nodes
+     * @param count
+     */
+    [[nodiscard]] bool _fits(const _node* nodes, int count) const
+    {
+        ptr length = 0;
+#ifdef BOOKSTORE_FRONT_CODING
+        length += sizeof(int);
+#endif
+        for (int i = 0; i < count; ++i) length += _entry_length(nodes[i], (i == 0) ? nullptr : nodes + i - 1);
+        return length <= _array_space();
+    }
+
+    /**
+     * This function returns the number of nodes to be kept in the first
+     * main node when an array is split into two, which is a half of the
+     * nodes (or a half of the code with front coding).
+     * @param nodes
+     * @param count
+     */
+    [[nodiscard]] int _split_index([[maybe_unused]] const _node* nodes, int count) const
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        ptr total = 0;
+        for (int i = 0; i < count; ++i) total += _entry_length(nodes[i], (i == 0) ? nullptr : nodes + i - 1);
+        ptr length = 0;
+        int index = 0;
+        while (index < count - 1 && 2 * length < total) {
+            length += _entry_length(nodes[index], (index == 0) ? nullptr : nodes + index - 1);
+            ++index;
+        }
+        return std::max(index, 1);
+#else
+        return count / 2;
+#endif
+    }
+
+    /**
+     * This function reads the array of a main node.
+     * @param mainNode
+     * @param target the place to put the nodes
+     */
+    void _read_array(const _main_node& mainNode, _node* target)
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        if (mainNode.count == 0) return;
+        int length;
+        _list.read(mainNode.target, reinterpret_cast<char*>(&length), sizeof(int));
+        _code.resize(length);
+        _list.read(mainNode.target + sizeof(int), _code.data(), length);
+        const char* code = _code.data();
+        for (int i = 0; i < mainNode.count; ++i) {
+            forEachField(target[i].key, (i == 0) ? nullptr : &target[i - 1].key,
+                         [&code](auto& field, const auto* previous) { code = frontDecode(code, field, previous); });
+            code = plainDecode(code, target[i].value);
+        }
+#else
+        _list.read(mainNode.target, reinterpret_cast<char*>(target), mainNode.count * sizeof(_node));
+#endif
+    }
+
+    /**
+     * This function writes the array of a main node.  Only the nodes
+     * from the given index are written if they are not front coded.
+     * <br><br>
+     * WARNING: the array MUST fit into the space of the main node.
+     * @param mainNode
+     * @param source
+     * @param from the index of the first node that is changed
+     */
+    void _write_array(const _main_node& mainNode, const _node* source, [[maybe_unused]] int from = 0)
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        _encode(source, mainNode.count);
+        _list.write(mainNode.target, _code.data(), static_cast<ptr>(_code.size()));
+#else
+        _list.write(mainNode.target + from * sizeof(_node), reinterpret_cast<const char*>(source + from),
+                    (mainNode.count - from) * sizeof(_node));
+#endif
+    }
+
+    /**
+     * This function reads the whole array of a main node into the block
+     * buffer.
+     * @param mainNode
+     */
+    void _load_block(const _main_node& mainNode)
+    {
+        const size_t length = static_cast<size_t>(_head.maxNodeSize) + 1;
+        if (_block.size() < length) _block.resize(length);
+        _read_array(mainNode, _block.data());
+    }
+
+    /**
+     * This function reads a node in the array of a main node.
+     * @param mainNode
+     * @param index
+     * @return the node
+     */
+    _node _read_node(const _main_node& mainNode, int index)
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        _load_block(mainNode);
+        return _block[index];
+#else
+        _node node;
+        _list.read(mainNode.target + index * sizeof(_node), reinterpret_cast<char*>(&node), sizeof(_node));
+        return node;
+#endif
+    }
+
+    /**
+     * This function replaces a node in the array of a main node with
+     * another one with the same keys.
+     * @param mainNode
+     * @param index
+     * @param node
+     */
+    void _write_node(const _main_node& mainNode, int index, const _node& node)
+    {
+#ifdef BOOKSTORE_FRONT_CODING
+        _load_block(mainNode);
+        _block[index] = node;
+        _write_array(mainNode, _block.data());
+#else
+        _list.write(mainNode.target + index * sizeof(_node), reinterpret_cast<const char*>(&node), sizeof(_node));
+#endif
+    }
+
     /**
      * This function return a pair of the pointer to the main node
      * and the number of node the target is right after, for the case
@@ -76,22 +500,16 @@ private:
      * node ahead of its place (except the case that the key is less than
      * any other keys, and in such case, it will return the first main node).
      * @param key
-     * @return a pair of the pointer to the main node and the offset (0-based)
+     * @return a pair of the pointer to the main node and the offset
      */
-    std::pair<ptr, int> _find(const keyType& key)
+    std::pair<ptr, int> _find(const _key& key)
     {
         if (_head.next == 0) return std::make_pair(0, -1);
-        _main_node tmp;
-        ptr Ptr = _head.pre;
-        _list.seekg(_head.pre);
-        _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
 
         // Searching for the approximate place (only the main node)
-        while (key < tmp.key && tmp.pre != 0) {
-            Ptr = tmp.pre;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-        }
+        _main_node tmp;
+        ptr Ptr = _directory[_search_directory(key)].target;
+        _read_main(Ptr, tmp);
 
         // Searching for the exact place
 
@@ -99,22 +517,20 @@ private:
 
         if (key == tmp.key || tmp.count == 0) return std::make_pair(Ptr, -1);
 
+        _load_block(tmp);
         _node tmpNode;
         int leftIndex = 0, rightIndex = tmp.count - 1;
 
         // the case that the key is between the main node and the first node
-        _list.seekg(tmp.target);
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+        tmpNode = _block[0];
         if (key < tmpNode.key) return std::make_pair(Ptr, -1);
 
         // the case that the key is right after the last node
-        _list.seekg(tmp.target + (tmp.count - 1) * sizeof(_node));
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+        tmpNode = _block[tmp.count - 1];
         if (tmpNode.key < key || tmpNode.key == key) return std::make_pair(Ptr, tmp.count - 1);
 
         while (rightIndex - leftIndex > 1) {
-            _list.seekg(tmp.target + ((rightIndex + leftIndex) / 2) * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+            tmpNode = _block[(rightIndex + leftIndex) / 2];
             if (key < tmpNode.key) rightIndex = (rightIndex + leftIndex) / 2;
             else leftIndex = (rightIndex + leftIndex) / 2;
         }
@@ -127,25 +543,21 @@ private:
      * and the number of node the target is right after, for the case
      * of the main node, the second member of the pair is -1.  If the
      * key doesn't belongs to the unrolled linked list, it will return
-     * {-1, -1}.
+     * {-1, -1}.  When the key is found, the main node is left in tmp,
+     * and if the key is in its array, the array is left in the block
+     * buffer, so that the caller needn't read them again.
      * @param key
+     * @param tmp the main node found
      * @return a pair of the pointer to the main node and the offset
      */
-    std::pair<ptr, int> _find_exact(const keyType& key)
+    std::pair<ptr, int> _find_exact(const _key& key, _main_node& tmp)
     {
         if (_head.next == 0) return std::make_pair(-1, -1);
-
-        _main_node tmp;
-        ptr Ptr = _head.pre;
-        _list.seekg(_head.pre);
-        _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
+        if (!_may_contain(key)) return std::make_pair(-1, -1);
 
         // Searching for the approximate place (only the main node)
-        while (key < tmp.key && tmp.pre != 0) {
-            Ptr = tmp.pre;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-        }
+        ptr Ptr = _directory[_search_directory(key)].target;
+        _read_main(Ptr, tmp);
 
         // Searching for the exact place
 
@@ -155,34 +567,147 @@ private:
 
         if (tmp.count == 0) return std::make_pair(-1, -1);
 
+        _load_block(tmp);
         _node tmpNode;
         int leftIndex = 0, rightIndex = tmp.count - 1;
 
         // the case that the key is between the main node and the first node
-        _list.seekg(tmp.target);
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+        tmpNode = _block[0];
         if (key < tmpNode.key) return std::make_pair(-1, -1);
 
         // the case that the key is right after the last node
-        _list.seekg(tmp.target + (tmp.count - 1) * sizeof(_node));
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+        tmpNode = _block[tmp.count - 1];
         if (tmpNode.key < key) return std::make_pair(-1, -1);
 
         if (tmpNode.key == key) return std::make_pair(Ptr, tmp.count - 1);
 
         while (rightIndex - leftIndex > 1) {
-            _list.seekg(tmp.target + ((rightIndex + leftIndex) / 2) * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+            tmpNode = _block[(rightIndex + leftIndex) / 2];
             if (key < tmpNode.key) rightIndex = (rightIndex + leftIndex) / 2;
             else leftIndex = (rightIndex + leftIndex) / 2;
         }
 
-        _list.seekg(tmp.target + leftIndex * sizeof(_node));
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+        tmpNode = _block[leftIndex];
         if (tmpNode.key == key) return std::make_pair(Ptr, leftIndex);
         else return std::make_pair(-1, -1);
     }
 
+    /**
+     * This function returns the number of the ranges of the keys, which
+     * are the ones of the main nodes: the index-th range is from the key
+     * of the index-th main node (or the least key for the first one) to
+     * the key of the next main node (or the greatest key for the last
+     * one).  There is a range for all the keys of an empty list as well.
+     */
+    [[nodiscard]] size_t _range_count() const
+    {
+        return std::max<size_t>(_directory.size(), 1);
+    }
+
+    /**
+     * This function returns the index of the range of a key.
+     * @param key
+     */
+    size_t _range_of(const _key& key) const
+    {
+        return _directory.empty() ? 0 : _search_directory(key);
+    }
+
+    /**
+     * This function returns the index of the range where the keys with
+     * the given leading fields begin (if there are any).
+     * @param prefix
+     */
+    template <class prefixType>
+    size_t _prefix_range(const prefixType& prefix) const
+    {
+        // the index of the first main node whose leading fields are no less than the prefix
+        size_t leftIndex = 0, rightIndex = _directory.size();
+        while (leftIndex < rightIndex) {
+            size_t middle = (leftIndex + rightIndex) / 2;
+            if (comparePrefix(_directory[middle].key, prefix) < 0) leftIndex = middle + 1;
+            else rightIndex = middle;
+        }
+        return (leftIndex == 0) ? 0 : leftIndex - 1; // (the keys may begin in the array of the previous one)
+    }
+
+    /**
+     * This function reads the key-value pairs of a range in the order of
+     * the keys: the ones of its main node and its array, merged with the
+     * writes in the write buffer in the range, just as get sees them.
+     * @param index the index of the range
+     * @param prefetched the end of the main nodes read ahead before,
+     * which will be updated
+     * @param nodes the place to append the key-value pairs
+     */
+    void _read_range(size_t index, size_t& prefetched, std::vector<_node>& nodes)
+    {
+        const size_t begin = nodes.size();
+        if (!_directory.empty()) {
+            _read_ahead_from(index, prefetched);
+            _main_node mainNode;
+            _read_main(_directory[index].target, mainNode);
+            nodes.resize(begin + mainNode.count + 1);
+            nodes[begin] = _node{mainNode.key, mainNode.value};
+            _read_array(mainNode, nodes.data() + begin + 1);
+        }
+        if (_buffer.empty()) return;
+
+        auto first = (index == 0) ? _buffer.begin() : _buffer.lower_bound(_directory[index].key);
+        auto last = (index + 1 < _directory.size()) ? _buffer.lower_bound(_directory[index + 1].key) : _buffer.end();
+        if (first == last) return;
+        std::vector<_node> merged;
+        auto node = nodes.begin() + static_cast<std::ptrdiff_t>(begin);
+        for (auto write = first; write != last; ++write) {
+            while (node != nodes.end() && node->key < write->first) merged.push_back(*node++);
+            if (node != nodes.end() && node->key == write->first) ++node; // (the write replaces it)
+            if (write->second.has_value()) merged.push_back(_node{write->first, *write->second});
+        }
+        merged.insert(merged.end(), node, nodes.end());
+        nodes.resize(begin);
+        nodes.insert(nodes.end(), merged.begin(), merged.end());
+    }
+
+    /**
+     * This function gets the space for a new main node and its array.
+     * The space of a deleted main node is reused first, and the file
+     * grows only if there is no such space.
+     * @return the place of the space
+     */
+    ptr _allocate_node()
+    {
+        ptr place = _head.free;
+        if (place != 0) {
+            _main_node freeNode;
+            _read_main(place, freeNode);
+            _head.free = freeNode.next;
+            _head_dirty = true;
+            return place;
+        }
+
+        // to reserve the space for the main node and its array
+        place = _list.size();
+        _list.write(place + sizeof(_main_node) + _array_space() - sizeof(_node),
+                    reinterpret_cast<char*>(&_empty_node), sizeof(_node));
+        return place;
+    }
+
+    /**
+     * This function puts the space of a deleted main node into the free
+     * list so that it can be used by a new main node.
+     * @param mainNode the main node that has been deleted
+     * @param target the place of the main node
+     */
+    void _free_node(_main_node& mainNode, ptr target)
+    {
+        mainNode.count = 0;
+        mainNode.next = _head.free;
+        mainNode.pre = 0;
+        _write_main(target, mainNode);
+        _head.free = target;
+        _head_dirty = true;
+    }
+
     /**
      * This function delete a main node
      * @param mainNode the main node to be deleted
@@ -191,53 +716,47 @@ private:
     void _delete_node(_main_node& mainNode, ptr target)
     {
         _main_node pre, next;
+        _directory.erase(_directory.begin() + _search_directory(mainNode.key));
 
         // The case that the only main node is to be deleted
         if (mainNode.pre == 0 && mainNode.next == 0) {
             _head.pre = 0;
             _head.next = 0;
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _head_dirty = true;
+            _free_node(mainNode, target);
             return;
         }
 
         // The case that the main node is the first main Node
         if (mainNode.pre == 0) {
             _head.next = mainNode.next;
-            _list.seekg(mainNode.next);
-            _list.read(reinterpret_cast<char*>(&next), sizeof(_main_node));
+            _read_main(mainNode.next, next);
             next.pre = 0;
-            _list.seekp(mainNode.next);
-            _list.write(reinterpret_cast<char*>(&next), sizeof(_main_node));
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _write_main(mainNode.next, next);
+            _head_dirty = true;
+            _free_node(mainNode, target);
             return;
         }
 
         // The case that the main node is the last main node
         if (mainNode.next == 0) {
             _head.pre = mainNode.pre;
-            _list.seekp(mainNode.pre);
-            _list.read(reinterpret_cast<char*>(&pre), sizeof(_main_node));
+            _read_main(mainNode.pre, pre);
             pre.next = 0;
-            _list.seekp(mainNode.pre);
-            _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _write_main(mainNode.pre, pre);
+            _head_dirty = true;
+            _free_node(mainNode, target);
             return;
         }
 
         // The regular case
-        _list.seekp(mainNode.pre);
-        _list.read(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-        _list.seekg(mainNode.next);
-        _list.read(reinterpret_cast<char*>(&next), sizeof(_main_node));
+        _read_main(mainNode.pre, pre);
+        _read_main(mainNode.next, next);
         pre.next = mainNode.next;
         next.pre = mainNode.pre;
-        _list.seekp(mainNode.pre);
-        _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-        _list.seekp(mainNode.next);
-        _list.write(reinterpret_cast<char*>(&next), sizeof(_main_node));
+        _write_main(mainNode.pre, pre);
+        _write_main(mainNode.next, next);
+        _free_node(mainNode, target);
     }
 
     /**
@@ -252,879 +771,727 @@ private:
      */
     ptr _new_node(_main_node& mainNode, ptr target)
     {
-        if (target != 0) { // for a not empty list
+        if (target != 0) { // the case that the list isn't empty
+            // Get the previous main node
             _main_node pre, next;
-            _list.seekg(target);
-            _list.read(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-            if (pre.next != 0) { // the case that the next main node is not the first node
-                // Get the next
-                _list.seekg(pre.next);
-                _list.read(reinterpret_cast<char*>(&next), sizeof(_main_node));
-
-                // Set the previous and next node
-                _list.seekp(0, std::ios::end);
+            ptr place = _allocate_node();
+            _read_main(target, pre);
+
+            if (pre.next != 0) { // the node isn't the last main node
+                // Get the next main node
+                _read_main(pre.next, next);
+
+                // Change the data of both the previous and next node
                 mainNode.next = pre.next;
                 mainNode.pre = next.pre;
-                pre.next = _list.tellp();
-                next.pre = _list.tellp();
+                pre.next = place;
+                next.pre = place;
 
-                // Put the new node
+                // Set the new main node
                 mainNode.target = pre.next + sizeof(_main_node);
-                _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+                _write_main(pre.next, mainNode);
 
-                // Get a new space for its array
-                _list.seekp(_head.maxNodeSize * sizeof(_node), std::ios::end);
-                _list.write(reinterpret_cast<char*>(&_empty_node), sizeof(_node));
-
-                // Put back the previous and next main node
-                _list.seekp(mainNode.next);
-                _list.write(reinterpret_cast<char*>(&next), sizeof(_main_node));
-                _list.seekp(mainNode.pre);
-                _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
+                // Put back both the previous and next node
+                _write_main(mainNode.next, next);
+                _write_main(mainNode.pre, pre);
+                _directory.insert(_directory.begin() + _search_directory(mainNode.key) + 1,
+                                  _directory_entry{mainNode.key, pre.next});
                 return pre.next;
-            } else { // the case that the next main node is the first node
-                // Set the previous and next node
-                _list.seekp(0, std::ios::end);
+            } else {
+                // Change the data of both the previous and next node
                 mainNode.next = 0;
                 mainNode.pre = target;
-                pre.next = _list.tellp();
-                _head.pre = _list.tellp();
+                pre.next = place;
+                _head.pre = place;
 
-                // Put the new node
+                // Set the new main node
                 mainNode.target = pre.next + sizeof(_main_node);
-                _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-
-                // Get a new space for its array
-                _list.seekp(_head.maxNodeSize * sizeof(_node), std::ios::end);
-                _list.write(reinterpret_cast<char*>(&_empty_node), sizeof(_node));
+                _write_main(pre.next, mainNode);
 
-                // Put back the previous and next main node
-                _list.seekp(mainNode.pre);
-                _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-                _list.seekp(0);
-                _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+                // Put back both the previous and next node
+                _write_main(mainNode.pre, pre);
+                _head_dirty = true;
+                _directory.push_back(_directory_entry{mainNode.key, pre.next});
                 return pre.next;
             }
-        } else { // For an empty list
-            _list.seekp(0, std::ios::end);
-            _head.next = _list.tellp();
-            _head.pre = _list.tellp();
+        } else { // the case of an empty list
+            _head.next = _allocate_node();
+            _head.pre = _head.next;
             mainNode.target = _head.next + sizeof(_main_node);
             mainNode.next = 0;
             mainNode.pre = 0;
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-
-            // to reserve the space for the array of the main node
-            _list.seekp(_head.maxNodeSize * sizeof(_node), std::ios::end);
-            _list.write(reinterpret_cast<char*>(&_empty_node), sizeof(_node));
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _write_main(_head.next, mainNode);
+            _head_dirty = true;
+            _directory.push_back(_directory_entry{mainNode.key, _head.next});
             return _head.next;
         }
     }
 
     /**
-     * This function split a main node into two.
+     * This function split a main node into two.  The whole array of the
+     * main node MUST be in the block buffer.
      * @param mainNode
      * @param mainNodePtr
+     * @param from the index of the first node that is changed
      * @return the ptr of the main node
      */
-    ptr _split(_main_node& mainNode, ptr mainNodePtr)
+    ptr _split(_main_node& mainNode, ptr mainNodePtr, int from)
     {
         // Copy the extra string of nodes
-        auto* nodeBuffer = new _node[mainNode.count - _head.nodeSize];
-        for (int i = 0; i < mainNode.count - _head.nodeSize; ++i) {
-            _list.seekg(mainNode.target + sizeof(_node) * (_head.nodeSize + i));
-            _list.read(reinterpret_cast<char*>(&nodeBuffer[i]), sizeof(_node));
-        }
+        int keep = _split_index(_block.data(), mainNode.count);
+        std::vector<_node> nodeBuffer(_block.begin() + keep, _block.begin() + mainNode.count);
 
         // Create a new node
         ptr newMainNodePtr;
-        _main_node newMainNode{nodeBuffer[0].key, nodeBuffer[0].value, 0,
-                               mainNode.count - _head.nodeSize - 1, 0, 0};
+        _main_node newMainNode{nodeBuffer[0].key, nodeBuffer[0].value,
+                               0, mainNode.count - keep - 1, 0, 0};
 
         // Get a new space for the nodes
         newMainNodePtr = _new_node(newMainNode, mainNodePtr);
 
         // Change the count of the original node
-        _list.seekg(mainNodePtr);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        mainNode.count = _head.nodeSize;
-        _list.seekp(mainNodePtr);
-        _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        _read_main(mainNodePtr, mainNode);
+        mainNode.count = keep;
+        _write_main(mainNodePtr, mainNode);
+        _write_array(mainNode, _block.data(), std::min(from, keep));
 
         // Get the new main node
-        _list.seekg(newMainNodePtr);
-        _list.read(reinterpret_cast<char*>(&newMainNode), sizeof(_main_node));
+        _read_main(newMainNodePtr, newMainNode);
 
         // write the extra string of nodes
-        _list.seekp(newMainNode.target);
-        for (int i = 1; i <= newMainNode.count; ++i) {
-            _list.write(reinterpret_cast<char*>(&nodeBuffer[i]), sizeof(_node));
-        }
-        delete[] nodeBuffer;
+        _write_array(newMainNode, nodeBuffer.data() + 1);
         return newMainNodePtr;
     }
 
     /**
-     * This function reads a string of stuff and returns a pointer to the string.
-     * @param target the place to get the data
-     * @param length
-     * @return a pointer to the string
+     * This function writes the array in the block buffer back to a main
+     * node whose count has been changed, and splits the main node if it
+     * is larger than its expected size.
+     * @param mainNode
+     * @param mainNodePtr
+     * @param from the index of the first node that is changed
      */
-    char* _read(ptr target, int length)
+    void _store_block(_main_node& mainNode, ptr mainNodePtr, int from)
     {
-        char* buffer = new char[length];
-        _list.seekg(target);
-        _list.read(buffer, length);
-        return buffer;
+        if (mainNode.count >= _head.maxNodeSize || !_fits(_block.data(), mainNode.count)) {
+            _split(mainNode, mainNodePtr, from);
+        } else {
+            _write_array(mainNode, _block.data(), from);
+        }
     }
 
     /**
-     * This function writes a string of stuff.
-     * @param source the source pointer
-     * @param target the place to place the data
-     * @param length
+     * This function merges a main node that is too small with one of its
+     * neighbours.  If they are too large to be merged, the key-value
+     * pairs will be shared evenly between them instead.
+     * @param mainNode
+     * @param mainNodePtr
      */
-    void _write(char* source, ptr target, int length)
+    void _rebalance(_main_node& mainNode, ptr mainNodePtr)
     {
-        _list.seekp(target);
-        _list.write(source, length);
-    }
-
-public:
-    explicit UnrolledLinkedList(const std::string& fileName, int nodeSize = 316)
-    : _list(fileName), _head{0, 0, nodeSize, 2 * nodeSize}
-    {
-        _list.seekg(0);
-        _list.seekp(0);
-        if (_list.peek() == EOF) {
-            _list.seekg(0, std::ios::beg);
-            _list.seekp(0, std::ios::beg);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+        if (mainNode.pre == 0 && mainNode.next == 0) return; // the only main node
+
+        // Get the two main nodes (the left one is right before the right one)
+        _main_node left, right;
+        ptr leftPtr, rightPtr;
+        if (mainNode.next != 0) {
+            left = mainNode;
+            leftPtr = mainNodePtr;
+            rightPtr = mainNode.next;
+            _read_main(rightPtr, right);
         } else {
-            _list.read(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            right = mainNode;
+            rightPtr = mainNodePtr;
+            leftPtr = mainNode.pre;
+            _read_main(leftPtr, left);
+        }
+
+        // Collect the key-value pairs of both of them
+        std::vector<_node> nodes;
+        nodes.push_back(_node{left.key, left.value});
+        _load_block(left);
+        nodes.insert(nodes.end(), _block.begin(), _block.begin() + left.count);
+        nodes.push_back(_node{right.key, right.value});
+        _load_block(right);
+        nodes.insert(nodes.end(), _block.begin(), _block.begin() + right.count);
+
+        const int total = static_cast<int>(nodes.size());
+        if (total <= _head.nodeSize && _fits(nodes.data() + 1, total - 1)) { // the case that they can be merged
+            left.count = total - 1;
+            _write_main(leftPtr, left);
+            _write_array(left, nodes.data() + 1);
+            _delete_node(right, rightPtr);
+        } else { // the case that the key-value pairs are shared
+            const int half = total / 2;
+            // (with front coding, the halves may not fit, and then they are left as they are)
+            if (!_fits(nodes.data() + 1, half - 1) || !_fits(nodes.data() + half + 1, total - half - 1)) return;
+            left.count = half - 1;
+            _write_main(leftPtr, left);
+            _write_array(left, nodes.data() + 1);
+
+            _directory_entry& entry = _directory[_search_directory(right.key)];
+            entry.key = nodes[half].key;
+            right.key = nodes[half].key;
+            right.value = nodes[half].value;
+            right.count = total - half - 1;
+            _write_main(rightPtr, right);
+            _write_array(right, nodes.data() + half + 1);
         }
     }
 
-    ~UnrolledLinkedList() = default;
+    /**
+     * This function tells whether the key of a node is less than that of
+     * another one.
+     */
+    static bool _less(const _node& lhs, const _node& rhs)
+    {
+        return lhs.key < rhs.key;
+    }
 
     /**
-     * This function inserts a new key-value pair.
+     * This function returns the end of the sorted nodes from the given
+     * index that belong to a main node, which are the ones less than the
+     * key of the next main node.
+     * @param nodes
+     * @param begin the first node that belongs to the main node
+     * @param directoryIndex the index of the main node in the directory
+     * @return the index right after the last node that belongs to it
+     */
+    size_t _group_end(const std::vector<_node>& nodes, size_t begin, size_t directoryIndex) const
+    {
+        if (directoryIndex + 1 == _directory.size()) return nodes.size();
+        const _directory_entry& next = _directory[directoryIndex + 1];
+        size_t end = begin + 1;
+        while (end < nodes.size() && nodes[end].key < next.key) ++end;
+        return end;
+    }
+
+    /**
+     * This function collects a main node and its array.
+     * @param mainNode
+     * @param nodes the place to put the nodes (the first one is the main node)
+     */
+    void _collect(const _main_node& mainNode, std::vector<_node>& nodes)
+    {
+        nodes.clear();
+        nodes.push_back(_node{mainNode.key, mainNode.value});
+        _load_block(mainNode);
+        nodes.insert(nodes.end(), _block.begin(), _block.begin() + mainNode.count);
+    }
+
+    /**
+     * This function puts sorted nodes into a main node in place of its
+     * data.  If they are too many for one main node, the rest are put
+     * into new main nodes right after it, with nodeSize nodes in each.
      * <br><br>
-     * WARNING: the new node to be inserted CANNOT be the same of the
-     * node in the unrolled linked list, or it may cause severe and
-     * unexpected problem.
-     * @param key the new key
-     * @param value the value of the new key
+     * WARNING: the nodes CANNOT be empty, and they MUST be between the
+     * key of the previous main node and that of the next one.
+     * @param mainNode
+     * @param mainNodePtr
+     * @param directoryIndex the index of the main node in the directory
+     * @param nodes
      */
-    void insert(const keyType& key, const valueType& value)
+    void _spread(_main_node& mainNode, ptr mainNodePtr, size_t directoryIndex, const std::vector<_node>& nodes)
     {
-        std::pair<ptr, int> position = _find(key);
-        if (position.first == 0) {
-            _main_node mainNode{key, value, 0, 0, 0, 0};
-            _new_node(mainNode, 0);
-            return;
+        const int total = static_cast<int>(nodes.size());
+        int begin = 0;
+        ptr prePtr = 0;
+        while (begin < total) {
+            // Take the nodes of the next main node
+            int end = total;
+            if (total - begin - 1 >= _head.maxNodeSize || !_fits(nodes.data() + begin + 1, total - begin - 1)) {
+                ptr length = 0;
+#ifdef BOOKSTORE_FRONT_CODING
+                length += sizeof(int);
+#endif
+                end = begin + 1;
+                while (end < total && end - begin < _head.nodeSize) {
+                    length += _entry_length(nodes[end], (end == begin + 1) ? nullptr : &nodes[end - 1]);
+                    if (length > _array_space()) break;
+                    ++end;
+                }
+            }
+
+            if (begin == 0) { // the main node itself
+                _directory[directoryIndex].key = nodes[0].key;
+                mainNode.key = nodes[0].key;
+                mainNode.value = nodes[0].value;
+                mainNode.count = end - 1;
+                _write_main(mainNodePtr, mainNode);
+                _write_array(mainNode, nodes.data() + 1);
+                prePtr = mainNodePtr;
+            } else { // a new main node right after the previous one
+                _main_node newMainNode{nodes[begin].key, nodes[begin].value,
+                                       0, end - begin - 1, 0, 0};
+                prePtr = _new_node(newMainNode, prePtr);
+                _write_array(newMainNode, nodes.data() + begin + 1);
+            }
+            begin = end;
         }
+    }
 
-        // Get the main node
-        _main_node mainNode; // the place to place the new node
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-
-        _node tmpNode;
-        if (mainNode.pre == 0 && key < mainNode.key) {
-            // Push back the data
-            char* buffer = _read(mainNode.target, mainNode.count * sizeof(_node));
-            _write(buffer, mainNode.target + sizeof(_node), mainNode.count * sizeof(_node));
-            delete[] buffer;
-
-            // Move the data in main node to the first node of its array
-            tmpNode.key = mainNode.key;
-            tmpNode.value = mainNode.value;
-            _list.seekp(mainNode.target);
-            _list.write(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-
-            // set the new data in the main node
-            mainNode.key = key;
-            mainNode.value = value;
-            ++(mainNode.count);
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        } else {
-            // Move the node(s) after the node to be inserted
-            char* buffer = _read(mainNode.target + (position.second + 1) * sizeof(_node),
-                                 (mainNode.count - position.second - 1) * sizeof(_node));
-            _write(buffer, mainNode.target + (position.second + 2) * sizeof(_node),
-                   (mainNode.count - position.second - 1) * sizeof(_node));
-            delete[] buffer;
-
-            // Put the new node
-            _node newNode{key, value};
-            _list.seekp(mainNode.target + (position.second + 1) * sizeof(_node));
-            _list.write(reinterpret_cast<char*>(&newNode), sizeof(_node));
+    /**
+     * This function merges sorted key-value pairs into the main nodes,
+     * so that each main node is read and written at most once.
+     * <br><br>
+     * WARNING: the keys MUST be distinct, and none of them can be in the
+     * unrolled linked list.
+     * @param sorted the nodes sorted by the key
+     */
+    void _merge_insert(const std::vector<_node>& sorted)
+    {
+        ++_version;
+#ifdef BOOKSTORE_BLOOM_FILTER
+        if (_bloom != nullptr) {
+            if (_bloom->full()) _rebuild_bloom();
+            for (const _node& node : sorted) _bloom->add(keyHash(node.key.first));
+        }
+#endif
 
-            // Change the main node
-            ++(mainNode.count);
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        size_t index = 0;
+        if (_head.next == 0 && !sorted.empty()) { // the first key makes the first main node
+            _main_node mainNode{sorted[0].key, sorted[0].value, 0, 0, 0, 0};
+            _new_node(mainNode, 0);
+            index = 1;
         }
 
-        // Split the main node if it is larger its expected size
-        if (mainNode.count >= _head.maxNodeSize) {
-            _split(mainNode, position.first);
+        std::vector<_node> nodes, merged;
+        _main_node mainNode;
+        while (index < sorted.size()) {
+            size_t directoryIndex = _search_directory(sorted[index].key);
+            size_t end = _group_end(sorted, index, directoryIndex);
+            ptr mainNodePtr = _directory[directoryIndex].target;
+            _read_main(mainNodePtr, mainNode);
+            _collect(mainNode, nodes);
+
+            merged.clear();
+            std::merge(nodes.begin(), nodes.end(), sorted.begin() + index, sorted.begin() + end,
+                       std::back_inserter(merged), _less);
+            _spread(mainNode, mainNodePtr, directoryIndex, merged);
+            index = end;
         }
     }
 
-    void erase(const keyType& key)
+    /**
+     * This function erases sorted keys from the main nodes, so that
+     * each main node is read and written at most once (except for merging
+     * or rebalancing a main node that becomes too small).
+     * @param sorted the nodes of the keys sorted by the key
+     */
+    void _merge_erase(const std::vector<_node>& sorted)
     {
-        std::pair<ptr, int> position = _find_exact(key);
-        if (position.first == -1) return; // no such node
-
-        // Get the main node
+        ++_version;
+        std::vector<_node> nodes, rest;
         _main_node mainNode;
-        _node tmpNode;
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-
-        if (position.second == -1) { // the case that the target is in the main node
-            if (mainNode.count == 0) { // the case that there is only one key-value pair
-                _delete_node(mainNode, position.first);
-            } else { // the case that there is more than one key-value pair
-                // Set the main node
-                _list.seekg(mainNode.target);
-                _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-                mainNode.key = tmpNode.key;
-                mainNode.value = tmpNode.value;
-                --(mainNode.count);
+        size_t index = 0;
+        while (index < sorted.size() && _head.next != 0) {
+            size_t directoryIndex = _search_directory(sorted[index].key);
+            size_t end = _group_end(sorted, index, directoryIndex);
+            ptr mainNodePtr = _directory[directoryIndex].target;
+            _read_main(mainNodePtr, mainNode);
+            _collect(mainNode, nodes);
+
+            // Keep the nodes whose keys are not to be erased
+            rest.clear();
+            for (const _node& node : nodes) {
+                while (index < end && _less(sorted[index], node)) ++index;
+                if (index < end && !_less(node, sorted[index])) ++index;
+                else rest.push_back(node);
+            }
+            index = end;
+            if (rest.size() == nodes.size()) continue; // no such keys
 
-                // Put the main Node
-                _list.seekp(position.first);
-                _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+            if (rest.empty()) {
+                _delete_node(mainNode, mainNodePtr);
+            } else {
+                _spread(mainNode, mainNodePtr, directoryIndex, rest);
 
-                // Move forward the other nodes
-                char* buffer = _read(mainNode.target + sizeof(_node), mainNode.count * sizeof(_node));
-                _write(buffer, mainNode.target, mainNode.count * sizeof(_node));
-                delete[] buffer;
+                // Merge or rebalance the main node if it is too small
+                if (static_cast<int>(rest.size()) < _min_size) _rebalance(mainNode, mainNodePtr);
             }
-        } else { // the case that the target is not in the main node
-            // Set and put the main node
-            --(mainNode.count);
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-
-            // Move forward the other nodes
-            char* buffer = _read(mainNode.target + (position.second + 1) *sizeof(_node),
-                                 (mainNode.count - position.second) * sizeof(_node));
-            _write(buffer, mainNode.target + position.second *sizeof(_node),
-                   (mainNode.count - position.second) * sizeof(_node));
-            delete[] buffer;
         }
     }
 
-    void modify(const keyType& key, const valueType& value)
-    {
-        std::pair<ptr, int> position = _find_exact(key);
-        if (position.first == -1) return; // no such node
-        _main_node mainNode;
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        if (position.second == -1) {
-            mainNode.value = value;
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        } else {
-            _node tmpNode;
-            _list.seekg(mainNode.target + position.second * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            tmpNode.value = value;
-            _list.seekp(mainNode.target + position.second * sizeof(_node));
-            _list.write(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-        }
-    }
+    /**
+     * @struct _buffer_record{erased, key, value}
+     *
+     * This is a write kept in the write buffer, which is also appended
+     * to the file of the buffer so that it is committed with the command.
+     */
+    struct _buffer_record {
+        bool erased;
+
+        _key key;
+
+        valueType value;
+    };
+
+    // the writes that have not been merged into the main nodes (std::nullopt for an erased key)
+    std::map<_key, std::optional<valueType>> _buffer;
+
+    size_t _buffer_capacity = 0; // 0 if the writes are not buffered
+
+    std::string _buffer_file_name;
+
+    std::unique_ptr<StorageFile> _buffer_file; // nullptr before the buffer is used
 
     /**
-     * The function clears all the data in the unrolled linked list
+     * This function opens the file of the write buffer (and creates it
+     * if it doesn't exist).
      */
-    void clear()
+    void _open_buffer_file()
     {
-        _head.next = 0;
-        _head.pre = 0;
-        _list.seekp(0);
-        _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+        if (_buffer_file != nullptr) return;
+        _buffer_file = std::make_unique<StorageFile>(_buffer_file_name);
     }
 
     /**
-     * This function gets the point of the value of a certain key.
-     * If the key doesn't exist, a nullptr will be returned instead.
-     * <br><br>
-     * WARNING: If the function doesn't return a nullptr, ALWAYS free
-     * the memory whenever you don't need it.
+     * This function puts a write into the write buffer, and merges the
+     * buffer into the main nodes when it is full.
      * @param key
-     * @return the point of the value of a certain key.
-     * <br>
-     * If the key doesn't exist, a nullptr will be returned instead.
+     * @param value std::nullopt to erase the key
      */
-    valueType* get(const keyType& key)
+    void _buffer_write(const _key& key, const std::optional<valueType>& value)
     {
-        std::pair<ptr, int> position = _find_exact(key);
-        if (position.first == -1) return nullptr; // no such node
-        _main_node mainNode;
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        if (position.second == -1) {
-            return new valueType(mainNode.value);
-        } else {
-            _node tmpNode;
-            _list.seekg(mainNode.target + position.second * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            return new valueType(tmpNode.value);
-        }
+        _buffer[key] = value;
+        _buffer_record record{!value.has_value(), key, value.value_or(valueType())};
+        _buffer_file->write(_buffer_file->size(), reinterpret_cast<char*>(&record), sizeof(_buffer_record));
+        if (_buffer.size() >= _buffer_capacity) _drain();
     }
 
-    std::vector<valueType> traverse()
+    /**
+     * This function merges the write buffer into the main nodes.  All the
+     * keys in the buffer are erased at first, and then the ones with
+     * values are inserted again, both in a single pass.
+     */
+    void _drain()
     {
-        std::vector<valueType> values; // can be optimized
-        _main_node mainNode;
-        _node node;
-        ptr mainPtr = _head.next;
-        while (mainPtr != 0) {
-            _list.seekg(mainPtr);
-            _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-            values.emplace_back(mainNode.value);
-            for (int i = 0; i < mainNode.count; ++i) {
-                _list.seekg(mainNode.target + i * sizeof(_node));
-                _list.read(reinterpret_cast<char*>(&node), sizeof(_node));
-                values.emplace_back(node.value);
-            }
-            mainPtr = mainNode.next;
+        if (_buffer.empty()) return;
+        std::vector<_node> erased, inserted; // (the map is sorted by the key)
+        for (const auto& [key, value] : _buffer) {
+            erased.push_back(_node{key, valueType()});
+            if (value.has_value()) inserted.push_back(_node{key, *value});
         }
-        return std::move(values);
+        _buffer.clear();
+        _buffer_file->resize(0);
+        _merge_erase(erased);
+        _merge_insert(inserted);
     }
 
-    void flush()
+    /**
+     * This function reads the writes left in the file of the write
+     * buffer by the last run, and merges them into the main nodes.
+     */
+    void _recover_buffer()
     {
-        _list.flush();
+        if (!Container::instance().exists(_buffer_file_name)) return;
+        _open_buffer_file();
+        _buffer_record record;
+        for (offset_t position = 0; position + static_cast<offset_t>(sizeof(_buffer_record)) <= _buffer_file->size();
+             position += sizeof(_buffer_record)) {
+            _buffer_file->read(position, reinterpret_cast<char*>(&record), sizeof(_buffer_record));
+            _buffer[record.key] =
+                    record.erased ? std::nullopt : std::optional<valueType>(record.value);
+        }
+        _drain();
     }
-};
-
-/**
- * @class DoubleUnrolledLinkedList
- *
- * This is a template class of double unrolled linked list on disk.
- * <br><br>
- * WARNING: the key type MUST have valid operator< and operator== !
- *
- * @tparam keyType1 Type of First key
- * @tparam keyType2 Type of Second key
- * @tparam valueType Type of Value
- */
-template <class keyType1, class keyType2, class valueType>
-class DoubleUnrolledLinkedList {
-private:
-    typedef int ptr;
-
-    std::fstream _list;
-
-    /// The following are private components of this linked list
 
     /**
-     * @struct _first_node{next, pre, nodeSize, maxNodeSize}
-     *
-     * This is the node to pointer to the data, and metadata of the list
+     * This function tells whether a key may be in the list, which is
+     * false only if the Bloom filter of a key of a single field says that
+     * it isn't.
+     * @param key
      */
-    struct _first_node {
-        ptr next; // the first main node
-
-        ptr pre; // the last main node
-
-        int nodeSize;
-
-        int maxNodeSize;
-    } _head;
+    bool _may_contain([[maybe_unused]] const _key& key) const
+    {
+#ifdef BOOKSTORE_BLOOM_FILTER
+        if (_bloom != nullptr) return _bloom->mayContain(keyHash(key.first));
+#endif
+        return true;
+    }
 
+#ifdef BOOKSTORE_BLOOM_FILTER
     /**
-     * @struct _main_node{key1, key2, value, target, count, next, pre}
-     *
-     * This is the node to store the pointer and data, and
-     * link other main nodes.
+     * This function resets the Bloom filter with all the keys in the list.
      */
-    struct _main_node {
-        keyType1 key1;
-
-        keyType2 key2;
-
-        valueType value;
-
-        ptr target;
-
-        int count;
-
-        ptr next;
-
-        ptr pre;
-    };
+    void _rebuild_bloom()
+    {
+        std::vector<std::uint64_t> hashes;
+        _main_node mainNode;
+        ptr mainPtr = _head.next;
+        while (mainPtr != 0) {
+            _read_main(mainPtr, mainNode);
+            hashes.push_back(keyHash(mainNode.key.first));
+            _load_block(mainNode);
+            for (int i = 0; i < mainNode.count; ++i) hashes.push_back(keyHash(_block[i].key.first));
+            mainPtr = mainNode.next;
+        }
+        _bloom->reset(hashes);
+    }
+#endif
 
     /**
-     * @struct _node{key1, key2, value}
-     *
-     * This is the Node to store data.
+     * This function returns the nodeSize of a new list.  If it is not
+     * given, the array of a main node with nodeSize key-value pairs takes
+     * about targetArraySize bytes, so that the larger the key-value pairs
+     * are, the fewer of them a main node keeps.
+     * @param nodeSize the given nodeSize (0 if it is not given)
      */
-    struct _node {
-        keyType1 key1;
-
-        keyType2 key2;
-
-        valueType value;
-    } _empty_node;
+    static int _node_size(int nodeSize)
+    {
+        if (nodeSize > 0) return nodeSize;
+        return std::max(static_cast<int>(targetArraySize / sizeof(_node)), 4);
+    }
 
     /**
-     * This function return a pair of the pointer to the main node
-     * and the number of node the target is right after, for the case
-     * of the main node, the second member of the pair is -1.  If the
-     * key doesn't belongs to the unrolled linked list, it will the
-     * node ahead of its place (except the case that the key is less than
-     * any other keys, and in such case, it will return the first main node).
-     * @param key
-     * @return a pair of the pointer to the main node and the offset
+     * These functions turn an element given to bulkLoad into a node.
      */
-    std::pair<ptr, int> _find(const keyType1& key1, const keyType2& key2)
+    static const _node& _to_node(const _node& node)
     {
-        if (_head.next == 0) return std::make_pair(0, -1);
-
-        _main_node tmp;
-        ptr Ptr = _head.pre;
-        _list.seekg(_head.pre);
-        _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-
-        // Searching for the approximate place (only the main node)
-        while ((key1 < tmp.key1 || (key1 == tmp.key1 && key2 < tmp.key2)) && tmp.pre != 0) {
-            Ptr = tmp.pre;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-        }
-
-        // Searching for the exact place
-
-        if (tmp.pre == 0 && (key1 < tmp.key1 || (key1 == tmp.key1 && key2 < tmp.key2))) return std::make_pair(Ptr, -1);
-
-        if (key1 == tmp.key1 && key2 == tmp.key2 || tmp.count == 0) return std::make_pair(Ptr, -1);
-
-        _node tmpNode;
-        int leftIndex = 0, rightIndex = tmp.count - 1;
-
-        // the case that the key is between the main node and the first node
-        _list.seekg(tmp.target);
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-        if (key1 < tmpNode.key1 || (key1 == tmpNode.key1 && key2 < tmpNode.key2)) {
-            return std::make_pair(Ptr, -1);
-        }
-
-        // the case that the key is right after the last node
-        _list.seekg(tmp.target + (tmp.count - 1) * sizeof(_node));
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-        if (tmpNode.key1 < key1 || (tmpNode.key1 == key1 && (tmpNode.key2 < key2 || tmpNode.key2 == key2))) {
-            return std::make_pair(Ptr, tmp.count - 1);
-        }
-
-        while (rightIndex - leftIndex > 1) {
-            _list.seekg(tmp.target + ((rightIndex + leftIndex) / 2) * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (key1 < tmpNode.key1 || (key1 == tmpNode.key1 && key2 < tmpNode.key2)) {
-                rightIndex = (rightIndex + leftIndex) / 2;
-            } else {
-                leftIndex = (rightIndex + leftIndex) / 2;
-            }
-        }
+        return node;
+    }
 
-        return std::make_pair(Ptr, leftIndex);
+    static _node _to_node(const typename _traits::entryArgument& entry)
+    {
+        return _node{_traits::toKey(entry), _traits::toValue(entry)};
     }
 
     /**
-     * This function return a pair of the pointer to the main node
-     * and the number of node the target is right after, for the case
-     * of the main node, the second member of the pair is -1.  If the
-     * key doesn't belongs to the unrolled linked list, it will return
-     * {-1, -1}.
-     * @param key1
-     * @param key2
-     * @return a pair of the pointer to the main node and the offset
+     * This function is bulkLoad without taking the lock.
      */
-    std::pair<ptr, int> _find_exact(const keyType1& key1, const keyType2& key2)
+    template <class Iterator>
+    void _bulk_load(Iterator begin, Iterator end, double fillFactor)
     {
-        if (_head.next == 0) return std::make_pair(-1, -1);
-
-        _main_node tmp;
-        ptr Ptr = _head.pre;
-        _list.seekg(_head.pre);
-        _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-
-        // Searching for the approximate place (only the main node)
-        while ((key1 < tmp.key1 || (key1 == tmp.key1 && key2 < tmp.key2)) && tmp.pre != 0) {
-            Ptr = tmp.pre;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
+        ++_version;
+        const int nodeCapacity = std::clamp(static_cast<int>(fillFactor * _head.nodeSize), 1, _head.maxNodeSize - 1);
+        const ptr space = sizeof(_main_node) + _array_space();
+        ptr place = sizeof(_first_node), pre = 0;
+        if (!_buffer.empty()) {
+            _buffer.clear();
+            _buffer_file->resize(0);
         }
+        _main_cache.clear(); // (the main nodes are all replaced)
+        _head.next = 0;
+        _head.free = 0;
+        _directory.clear();
 
-        // Searching for the exact place
-
-        if (tmp.pre == 0 && (key1 < tmp.key1 || (key1 == tmp.key1 && key2 < tmp.key2))) return std::make_pair(-1, -1);
-
-        if (key1 == tmp.key1 && key2 == tmp.key2) return std::make_pair(Ptr, -1);
-
-        if (tmp.count == 0) return std::make_pair(-1, -1);
-
-        _node tmpNode;
-        int leftIndex = 0, rightIndex = tmp.count - 1;
-
-        // the case that the key is between the main node and the first node
-        _list.seekg(tmp.target);
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-        if (key1 < tmpNode.key1 || (key1 == tmpNode.key1 && key2 < tmpNode.key2)) return std::make_pair(-1, -1);
-
-        // the case that the key is right after the last node
-        _list.seekg(tmp.target + (tmp.count - 1) * sizeof(_node));
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-        if (tmpNode.key1 < key1 || (tmpNode.key1 == key1 && tmpNode.key2 < key2)) return std::make_pair(-1, -1);
-
-        if (tmpNode.key1 == key1 && tmpNode.key2 == key2) return std::make_pair(Ptr, tmp.count - 1);
+        std::vector<_node> nodes;
+#ifdef BOOKSTORE_BLOOM_FILTER
+        std::vector<std::uint64_t> hashes;
+#endif
+        _main_node mainNode;
+        while (begin != end) {
+            // Take the data of the next main node
+            nodes.clear();
+            ptr length = 0;
+#ifdef BOOKSTORE_FRONT_CODING
+            length += sizeof(int);
+#endif
+            for (; begin != end && static_cast<int>(nodes.size()) < nodeCapacity; ++begin) {
+                const _node& node = _to_node(*begin);
+                if (!nodes.empty()) { // the first node is put into the main node
+                    length += _entry_length(node, (nodes.size() == 1) ? nullptr : &nodes.back());
+                    if (length > _array_space()) break;
+                }
+                nodes.push_back(node);
+            }
 
-        while (rightIndex - leftIndex > 1) {
-            _list.seekg(tmp.target + ((rightIndex + leftIndex) / 2) * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (key1 < tmpNode.key1 || (key1 == tmpNode.key1 && key2 < tmpNode.key2)) {
-                rightIndex = (rightIndex + leftIndex) / 2;
-            } else {
-                leftIndex = (rightIndex + leftIndex) / 2;
+            // Put the main node and its array right after the previous one
+            int count = static_cast<int>(nodes.size()) - 1;
+            mainNode = _main_node{nodes[0].key, nodes[0].value, 0, count, 0, pre};
+            mainNode.target = place + sizeof(_main_node);
+            if (begin != end) mainNode.next = place + space;
+            _write_main(place, mainNode);
+            _write_array(mainNode, nodes.data() + 1);
+            _directory.push_back(_directory_entry{mainNode.key, place});
+#ifdef BOOKSTORE_BLOOM_FILTER
+            if (_bloom != nullptr) {
+                for (const _node& node : nodes) hashes.push_back(keyHash(node.key.first));
             }
+#endif
+            if (pre == 0) _head.next = place;
+            pre = place;
+            place += space;
         }
-
-        _list.seekg(tmp.target + leftIndex * sizeof(_node));
-        _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-        if (tmpNode.key1 == key1 && tmpNode.key2 == key2) return std::make_pair(Ptr, leftIndex);
-        else return std::make_pair(-1, -1);
+        _head.pre = pre;
+        _head_dirty = true;
+        _list.resize(place);
+#ifdef BOOKSTORE_BLOOM_FILTER
+        if (_bloom != nullptr) _bloom->reset(hashes);
+#endif
     }
 
+    static constexpr ptr _compact_threshold = 64; // the number of free main nodes to compact the list
+
     /**
-     * This function return a pair of the pointer to the main node
-     * and the number of node the target is right after, for the case
-     * of the main node, the second member of the pair is -1.  If the
-     * key doesn't belongs to the unrolled linked list, it will return
-     * {-1, -1}.
-     * @param key1
-     * @param key2
-     * @return a pair of the pointer to the main node and the offset
+     * This function tells whether most of the file is taken by the space
+     * of the deleted main nodes (and there are at least _compact_threshold
+     * of them), so that the list should be compacted.
      */
-    std::pair<ptr, int> _single_find(const keyType1& key1)
+    [[nodiscard]] bool _sparse() const
     {
-        if (_head.next == 0) return std::make_pair(-1, -1);
-
-        _main_node tmp;
-        ptr Ptr = _head.pre;
-        _list.seekg(_head.pre);
-        _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-        bool exist = false;
-
-        // Searching for the approximate place (only the main node)
-        while ((key1 < tmp.key1 || key1 == tmp.key1) && tmp.pre != 0) {
-            if (!exist && key1 == tmp.key1) exist = true;
-            Ptr = tmp.pre;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-        }
-        if (exist) {
-            while (key1 == tmp.key1 && tmp.pre != 0) {
-                Ptr = tmp.pre;
-                _list.seekg(Ptr);
-                _list.read(reinterpret_cast<char*>(&tmp), sizeof(_main_node));
-            }
-        }
-
-        // Searching for the exact place
-
-        if (tmp.pre == 0 && key1 < tmp.key1) return std::make_pair(-1, -1);
-
-        if (tmp.pre == 0 && key1 == tmp.key1) return std::make_pair(Ptr, -1);
-
-        if (tmp.count == 0) {
-            if (exist) return std::make_pair(tmp.next, -1);
-            else return std::make_pair(-1, -1);
-        }
-
-        _node tmpNode;
-        int leftIndex = 0, rightIndex = tmp.count - 1;
-
-        if (exist) {
-            // for the last node
-            _list.seekg(tmp.target + (tmp.count - 1) * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (tmpNode.key1 < key1) return std::make_pair(tmp.next, -1);
-
-            // for the first node
-            _list.seekg(tmp.target);
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (tmpNode.key1 == key1) return std::make_pair(Ptr, 0);
-
-            while (rightIndex - leftIndex > 1) {
-                _list.seekg(tmp.target + ((rightIndex + leftIndex) / 2) * sizeof(_node));
-                _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-                if (key1 == tmpNode.key1) rightIndex = (rightIndex + leftIndex) / 2;
-                else leftIndex = (rightIndex + leftIndex) / 2;
-            }
-            return std::make_pair(Ptr, rightIndex);
-        } else {
-            // the case that the key is between the main node and the first node
-            _list.seekg(tmp.target);
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (key1 < tmpNode.key1) return std::make_pair(-1, -1);
-            if (key1 == tmpNode.key1) return std::make_pair(Ptr, 0);
-
-            // the case that the key is right after the last node
-            _list.seekg(tmp.target + (tmp.count - 1) * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (tmpNode.key1 < key1) return std::make_pair(-1, -1);
-
-            while (rightIndex - leftIndex > 1) {
-                _list.seekg(tmp.target + ((rightIndex + leftIndex) / 2) * sizeof(_node));
-                _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-                if (tmpNode.key1 < key1) leftIndex = (rightIndex + leftIndex) / 2;
-                else rightIndex = (rightIndex + leftIndex) / 2;
-            }
-
-            _list.seekg(tmp.target + rightIndex * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            if (tmpNode.key1 == key1) return std::make_pair(Ptr, rightIndex);
-            else return std::make_pair(-1, -1);
-        }
+        const ptr total = (_list.size() - static_cast<ptr>(sizeof(_first_node))) /
+                          static_cast<ptr>(sizeof(_main_node) + _array_space());
+        const ptr free = total - static_cast<ptr>(_directory.size());
+        return free >= _compact_threshold && free > total / 2;
     }
 
     /**
-     * This function delete a main node
-     * @param mainNode the main node to be deleted
-     * @param target the place where the main node to be deleted is
+     * This function is compact without taking the lock.
      */
-    void _delete_node(_main_node& mainNode, ptr target)
+    void _compact()
     {
-        _main_node pre, next;
-
-        // The case that the only main node is to be deleted
-        if (mainNode.pre == 0 && mainNode.next == 0) {
-            _head.pre = 0;
-            _head.next = 0;
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
-            return;
-        }
+        _drain();
 
-        // The case that the main node is the first main Node
-        if (mainNode.pre == 0) {
-            _head.next = mainNode.next;
-            _list.seekg(mainNode.next);
-            _list.read(reinterpret_cast<char*>(&next), sizeof(_main_node));
-            next.pre = 0;
-            _list.seekp(mainNode.next);
-            _list.write(reinterpret_cast<char*>(&next), sizeof(_main_node));
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
-            return;
-        }
-
-        // The case that the main node is the last main node
-        if (mainNode.next == 0) {
-            _head.pre = mainNode.pre;
-            _list.seekp(mainNode.pre);
-            _list.read(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-            pre.next = 0;
-            _list.seekp(mainNode.pre);
-            _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
-            return;
+        // Collect all the data in order
+        std::vector<_node> nodes;
+        _main_node mainNode;
+        ptr mainPtr = _head.next;
+        size_t index = 0, prefetched = 0;
+        while (mainPtr != 0) {
+            _read_ahead_from(index++, prefetched);
+            _read_main(mainPtr, mainNode);
+            nodes.push_back(_node{mainNode.key, mainNode.value});
+            _load_block(mainNode);
+            nodes.insert(nodes.end(), _block.begin(), _block.begin() + mainNode.count);
+            mainPtr = mainNode.next;
         }
 
-        // The regular case
-        _list.seekp(mainNode.pre);
-        _list.read(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-        _list.seekg(mainNode.next);
-        _list.read(reinterpret_cast<char*>(&next), sizeof(_main_node));
-        pre.next = mainNode.next;
-        next.pre = mainNode.pre;
-        _list.seekp(mainNode.pre);
-        _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-        _list.seekp(mainNode.next);
-        _list.write(reinterpret_cast<char*>(&next), sizeof(_main_node));
+        _bulk_load(nodes.begin(), nodes.end(), 1.0);
     }
 
+public:
+    // the size of the array of a main node with nodeSize key-value pairs
+    // when nodeSize is not given, which is a block of the buffer pool
+    static constexpr long targetArraySize = BufferPool::blockSize;
+
     /**
-     * This function makes a new main node right after the target.
+     * @class Cursor
+     *
+     * This is a forward cursor over the values in the order of the keys,
+     * which may be limited to the keys with certain leading fields.
+     * Only one range of the keys (a main node and its array, with the
+     * writes in the write buffer between its key and the next one) is
+     * kept in memory at a time.
      * <br><br>
-     * WARNING: If the target is 0, that means its a empty list.
-     * @param mainNode the new main node to be added to the unrolled
-     * linked list
-     * @param target the place where the new node is added (it MUST
-     * be a main node).
-     * @return the new place of the new main node.
+     * The ranges are read under the lock of the list, so several threads
+     * can move their own cursors at a time, and the list may be modified
+     * between them: the cursor goes on after the last key it has read,
+     * and sees the keys after it as they are when their range is read.
      */
-    ptr _new_node(_main_node& mainNode, ptr target)
-    {
-        if (target != 0) { // the case that the list isn't empty
-            // Get the previous main node
-            _main_node pre, next;
-            _list.seekg(target);
-            _list.read(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-
-            if (pre.next != 0) { // the node isn't the last main node
-                // Get the next main node
-                _list.seekg(pre.next);
-                _list.read(reinterpret_cast<char*>(&next), sizeof(_main_node));
+    class Cursor {
+        friend class CompositeUnrolledLinkedList;
 
-                // Change the data of both the previous and next node
-                _list.seekp(0, std::ios::end);
-                mainNode.next = pre.next;
-                mainNode.pre = next.pre;
-                pre.next = _list.tellp();
-                next.pre = _list.tellp();
+    private:
+        CompositeUnrolledLinkedList* _owner;
 
-                // Set the new main node
-                mainNode.target = pre.next + sizeof(_main_node);
-                _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        std::vector<_node> _nodes; // the range in memory
 
-                // Set a new space
-                _list.seekp(_head.maxNodeSize * sizeof(_node), std::ios::end);
-                _list.write(reinterpret_cast<char*>(&_empty_node), sizeof(_node));
+        size_t _index = 0; // the index of the next node in _nodes
 
-                // Put back both the previous and next node
-                _list.seekp(mainNode.next);
-                _list.write(reinterpret_cast<char*>(&next), sizeof(_main_node));
-                _list.seekp(mainNode.pre);
-                _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-                return pre.next;
-            } else {
-                // Change the data of both the previous and next node
-                _list.seekp(0, std::ios::end);
-                mainNode.next = 0;
-                mainNode.pre = target;
-                pre.next = _list.tellp();
-                _head.pre = _list.tellp();
+        size_t _next_range; // the index of the next range
 
-                // Set the new main node
-                mainNode.target = pre.next + sizeof(_main_node);
-                _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        size_t _prefetched = 0; // the end of the main nodes read ahead
 
-                // Set a new space
-                _list.seekp(_head.maxNodeSize * sizeof(_node), std::ios::end);
-                _list.write(reinterpret_cast<char*>(&_empty_node), sizeof(_node));
+        unsigned long _version; // the version of the list when the last range was read
 
-                // Put back both the previous and next node
-                _list.seekp(mainNode.pre);
-                _list.write(reinterpret_cast<char*>(&pre), sizeof(_main_node));
-                _list.seekp(0);
-                _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
-                return pre.next;
-            }
-        } else { // the case of an empty list
-            _list.seekp(0, std::ios::end);
-            _head.next = _list.tellp();
-            _head.pre = _list.tellp();
-            mainNode.target = _head.next + sizeof(_main_node);
-            mainNode.next = 0;
-            mainNode.pre = 0;
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        // whether a key has the leading fields of the cursor (always true for the whole list)
+        std::function<bool(const _key&)> _matches;
 
-            // to reserve the space for the array of the main node
-            _list.seekp(_head.maxNodeSize * sizeof(_node), std::ios::end);
-            _list.write(reinterpret_cast<char*>(&_empty_node), sizeof(_node));
-            _list.seekp(0);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
-            return _head.next;
+        Cursor(CompositeUnrolledLinkedList* owner, size_t range, const std::function<bool(const _key&)>& before,
+               std::function<bool(const _key&)> matches)
+        : _owner(owner), _next_range(range), _version(owner->_version), _matches(std::move(matches))
+        {
+            _load(before);
         }
-    }
 
-    /**
-     * This function split a main node into two.
-     * @param mainNode
-     * @param mainNodePtr
-     * @return the ptr of the main node
-     */
-    ptr _split(_main_node& mainNode, ptr mainNodePtr)
-    {
-        // Copy the extra string of nodes
-        auto* nodeBuffer = new _node[mainNode.count - _head.nodeSize];
-        for (int i = 0; i < mainNode.count - _head.nodeSize; ++i) {
-            _list.seekg(mainNode.target + sizeof(_node) * (_head.nodeSize + i));
-            _list.read(reinterpret_cast<char*>(&nodeBuffer[i]), sizeof(_node));
+        /**
+         * This function reads the next range that has keys after the place
+         * of the cursor, and drops the keys before it.
+         * <br><br>
+         * WARNING: the lock of the list MUST be held.
+         * @param before whether a key is before the place of the cursor
+         */
+        void _load(const std::function<bool(const _key&)>& before)
+        {
+            _nodes.clear();
+            _index = 0;
+            while (_nodes.empty() && _next_range < _owner->_range_count()) {
+                _owner->_read_range(_next_range++, _prefetched, _nodes);
+                _nodes.erase(_nodes.begin(), std::partition_point(_nodes.begin(), _nodes.end(),
+                                                                  [&before](const _node& node) {
+                                                                      return before(node.key);
+                                                                  }));
+            }
         }
 
-        // Create a new node
-        ptr newMainNodePtr;
-        _main_node newMainNode{nodeBuffer[0].key1, nodeBuffer[0].key2, nodeBuffer[0].value,
-                               0, mainNode.count - _head.nodeSize - 1, 0, 0};
-
-        // Get a new space for the nodes
-        newMainNodePtr = _new_node(newMainNode, mainNodePtr);
-
-        // Change the count of the original node
-        _list.seekg(mainNodePtr);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        mainNode.count = _head.nodeSize;
-        _list.seekp(mainNodePtr);
-        _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-
-        // Get the new main node
-        _list.seekg(newMainNodePtr);
-        _list.read(reinterpret_cast<char*>(&newMainNode), sizeof(_main_node));
-
-        // write the extra string of nodes
-        _list.seekp(newMainNode.target);
-        for (int i = 1; i <= newMainNode.count; ++i) {
-            _list.write(reinterpret_cast<char*>(&nodeBuffer[i]), sizeof(_node));
+    public:
+        /**
+         * This function tells whether there are more values.
+         */
+        [[nodiscard]] bool hasNext() const
+        {
+            return _index < _nodes.size() && _matches(_nodes[_index].key);
         }
-        delete[] nodeBuffer;
-        return newMainNodePtr;
-    }
 
-    /**
-     * This function reads a string of stuff and returns a pointer to the string.
-     * @param target the place to get the data
-     * @param length
-     * @return a pointer to the string
-     */
-    char* _read(ptr target, int length)
-    {
-        char* buffer = new char[length];
-        _list.seekg(target);
-        _list.read(buffer, length);
-        return buffer;
-    }
+        /**
+         * This function returns the next value and moves forward.
+         * <br><br>
+         * WARNING: there MUST be more values.
+         */
+        valueType next()
+        {
+            valueType value = _nodes[_index].value;
+            if (++_index == _nodes.size()) {
+                const _key last = _nodes.back().key;
+                std::shared_lock<FairSharedMutex> lock(_owner->_mutex);
+                if (_version != _owner->_version) { // the ranges may have been changed
+                    _version = _owner->_version;
+                    _next_range = _owner->_range_of(last);
+                    _prefetched = 0;
+                }
+                _load([&last](const _key& key) { return !(last < key); });
+            }
+            return value;
+        }
+    };
 
     /**
-     * This function writes a string of stuff.
-     * @param source the source pointer
-     * @param target the place to place the data
-     * @param length
+     * @param fileName
+     * @param nodeSize the number of key-value pairs in a main node after
+     * splitting (only used when the file is new, and 0 to make it fit
+     * targetArraySize)
+     * @param fillFactor a main node with fewer than fillFactor * nodeSize
+     * key-value pairs will be merged with or rebalanced against its
+     * neighbour.  It should be no more than 0.5.
      */
-    void _write(char* source, ptr target, int length)
+    explicit CompositeUnrolledLinkedList(const std::string& fileName, int nodeSize = 0, double fillFactor = 0.25)
+    : _list(fileName), _head{0, 0, 0, _node_size(nodeSize), 2 * _node_size(nodeSize)}
     {
-        _list.seekp(target);
-        _list.write(source, length);
-    }
-
-public:
-    explicit DoubleUnrolledLinkedList(const std::string& fileName, int nodeSize = 316)
-    : _list(fileName), _head{0, 0, nodeSize, 2 * nodeSize}
-    {
-        _list.seekg(0);
-        _list.seekp(0);
-        if (_list.peek() == EOF) {
-            _list.seekg(0, std::ios::beg);
-            _list.seekp(0, std::ios::beg);
-            _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+        if (_list.size() == 0) {
+            _list.write(0, reinterpret_cast<char*>(&_head), sizeof(_first_node));
         } else {
-            _list.read(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _list.read(0, reinterpret_cast<char*>(&_head), sizeof(_first_node));
+            _build_directory();
+        }
+        _min_size = static_cast<int>(fillFactor * _head.nodeSize);
+        if constexpr (_key_count == 1) {
+#ifdef BOOKSTORE_BLOOM_FILTER
+            _bloom = std::make_unique<BloomFilter>(fileName + "_bloom");
+            if (!_bloom->built()) _rebuild_bloom();
+#else
+            // (a filter left by a build with the filters misses the keys inserted since then)
+            Container::instance().remove(fileName + "_bloom");
+#endif
         }
+        _buffer_file_name = fileName + "_buffer";
+        _recover_buffer();
     }
 
-    ~DoubleUnrolledLinkedList() = default;
+    ~CompositeUnrolledLinkedList()
+    {
+        _write_back();
+    }
 
     /**
      * This function inserts a new key-value pair.
@@ -1132,139 +1499,139 @@ public:
      * WARNING: the new node to be inserted CANNOT be the same of the
      * node in the unrolled linked list, or it may cause severe and
      * unexpected problem.
-     * @param key1 the new key1
-     * @param key2 the new key2
+     * @param keys the fields of the new key
      * @param value the value of the new key
      */
-    void insert(const keyType1& key1, const keyType2& key2, const valueType& value)
+    void insert(const keyTypes&... keys, const valueType& value)
     {
-        std::pair<ptr, int> position = _find(key1, key2);
+        const _key key(keys...);
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (_buffer_capacity > 0) {
+            _buffer_write(key, value);
+            return;
+        }
+        ++_version;
+#ifdef BOOKSTORE_BLOOM_FILTER
+        if (_bloom != nullptr) {
+            if (_bloom->full()) _rebuild_bloom();
+            _bloom->add(keyHash(key.first));
+        }
+#endif
+        std::pair<ptr, int> position = _find(key);
         if (position.first == 0) {
-            _main_node mainNode{key1, key2, value, 0, 0, 0, 0};
+            _main_node mainNode{key, value, 0, 0, 0, 0};
             _new_node(mainNode, 0);
             return;
         }
 
         // Get the main node
         _main_node mainNode; // the place to place the new node
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        _read_main(position.first, mainNode);
 
-        _node tmpNode;
-        if (mainNode.pre == 0 && (key1 < mainNode.key1 || (key1 == mainNode.key1 && key2 < mainNode.key2))) {
+        _load_block(mainNode);
+        if (mainNode.pre == 0 && key < mainNode.key) {
             // Push back the data
-            char* buffer = _read(mainNode.target, mainNode.count * sizeof(_node));
-            _write(buffer, mainNode.target + sizeof(_node), mainNode.count * sizeof(_node));
-            delete[] buffer;
+            std::copy_backward(_block.begin(), _block.begin() + mainNode.count,
+                               _block.begin() + mainNode.count + 1);
 
             // Move the data in main node to the first node of its array
-            tmpNode.key1 = mainNode.key1;
-            tmpNode.key2 = mainNode.key2;
-            tmpNode.value = mainNode.value;
-            _list.seekp(mainNode.target);
-            _list.write(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+            _block[0] = _node{mainNode.key, mainNode.value};
 
             // set the new data in the main node
-            mainNode.key1 = key1;
-            mainNode.key2 = key2;
+            _directory.front().key = key;
+            mainNode.key = key;
             mainNode.value = value;
             ++(mainNode.count);
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+            _write_main(position.first, mainNode);
+
+            // Put the array (and split the main node if it is larger its expected size)
+            _store_block(mainNode, position.first, 0);
         } else {
             // Move the node(s) after the node to be inserted
-            char* buffer = _read(mainNode.target + (position.second + 1) * sizeof(_node),
-                                 (mainNode.count - position.second - 1) * sizeof(_node));
-            _write(buffer, mainNode.target + (position.second + 2) * sizeof(_node),
-                   (mainNode.count - position.second - 1) * sizeof(_node));
-            delete[] buffer;
+            std::copy_backward(_block.begin() + position.second + 1, _block.begin() + mainNode.count,
+                               _block.begin() + mainNode.count + 1);
 
             // Put the new node
-            _node newNode{key1, key2, value};
-            _list.seekp(mainNode.target + (position.second + 1) * sizeof(_node));
-            _list.write(reinterpret_cast<char*>(&newNode), sizeof(_node));
+            _block[position.second + 1] = _node{key, value};
 
             // Change the main node
             ++(mainNode.count);
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        }
+            _write_main(position.first, mainNode);
 
-        // Split the main node if it is larger its expected size
-        if (mainNode.count >= _head.maxNodeSize) {
-            _split(mainNode, position.first);
+            // Put the array (and split the main node if it is larger its expected size)
+            _store_block(mainNode, position.first, position.second + 1);
         }
     }
 
-    void erase(const keyType1& key1, const keyType2& key2)
+    void erase(const keyTypes&... keys)
     {
-        std::pair<ptr, int> position = _find_exact(key1, key2);
-        if (position.first == -1) return; // no such node
-
-        // Get the main node
+        const _key key(keys...);
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (_buffer_capacity > 0) {
+            _buffer_write(key, std::nullopt);
+            return;
+        }
+        ++_version;
         _main_node mainNode;
-        _node tmpNode;
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        std::pair<ptr, int> position = _find_exact(key, mainNode);
+        if (position.first == -1) return; // no such node
 
         if (position.second == -1) { // the case that the data is in the main node
             if (mainNode.count == 0) { // the case that the main node has no other members
                 _delete_node(mainNode, position.first);
+                return;
             } else { // the case that the main node has other members
                 // Set the main node
-                _list.seekg(mainNode.target);
-                _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-                mainNode.key1 = tmpNode.key1;
-                mainNode.key2 = tmpNode.key2;
-                mainNode.value = tmpNode.value;
+                _load_block(mainNode);
+                _directory_entry& entry = _directory[_search_directory(mainNode.key)];
+                entry.key = _block[0].key;
+                mainNode.key = _block[0].key;
+                mainNode.value = _block[0].value;
                 --(mainNode.count);
 
                 // Put the main Node
-                _list.seekp(position.first);
-                _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+                _write_main(position.first, mainNode);
 
                 // Move forward the other nodes
-                char* buffer = _read(mainNode.target + sizeof(_node), mainNode.count * sizeof(_node));
-                _write(buffer, mainNode.target, mainNode.count * sizeof(_node));
-                delete[] buffer;
+                std::copy(_block.begin() + 1, _block.begin() + mainNode.count + 1, _block.begin());
+                _store_block(mainNode, position.first, 0);
             }
         } else { // the case that the data is in the array of the main node
             // Set and put the main node
+            _load_block(mainNode);
             --(mainNode.count);
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+            _write_main(position.first, mainNode);
 
             // Move forward the other nodes
-            char* buffer = _read(mainNode.target + (position.second + 1) *sizeof(_node),
-                                 (mainNode.count - position.second) * sizeof(_node));
-            _write(buffer, mainNode.target + position.second *sizeof(_node),
-                   (mainNode.count - position.second) * sizeof(_node));
-            delete[] buffer;
+            std::copy(_block.begin() + position.second + 1, _block.begin() + mainNode.count + 1,
+                      _block.begin() + position.second);
+            _store_block(mainNode, position.first, position.second);
         }
+
+        // Merge or rebalance the main node if it is too small
+        if (mainNode.count + 1 < _min_size) _rebalance(mainNode, position.first);
     }
 
-    void modify(const keyType1& key1, const keyType2& key2,
-                const valueType& value)
+    void modify(const keyTypes&... keys, const valueType& value)
     {
-        std::pair<ptr, int> position = _find_exact(key1, key2);
-        if (position.first == -1) return; // no such node\
-
-        // Get the main node
+        const _key key(keys...);
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        auto iter = _buffer.find(key);
+        if (iter != _buffer.end()) { // the case that the key is in the write buffer
+            if (iter->second.has_value()) _buffer_write(key, value);
+            return;
+        }
         _main_node mainNode;
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        std::pair<ptr, int> position = _find_exact(key, mainNode);
+        if (position.first == -1) return; // no such node
 
         if (position.second == -1) { // the case that the data is in the main node
             mainNode.value = value;
-            _list.seekp(position.first);
-            _list.write(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+            _write_main(position.first, mainNode);
         } else { // the case that the data is in the array of the main node
-            _node tmpNode;
-            _list.seekg(mainNode.target + position.second * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+            _node tmpNode = _read_node(mainNode, position.second);
             tmpNode.value = value; // Modify the value
-            _list.seekp(mainNode.target + position.second * sizeof(_node));
-            _list.write(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
+            _write_node(mainNode, position.second, tmpNode);
         }
     }
 
@@ -1273,115 +1640,273 @@ public:
      */
     void clear()
     {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (!_buffer.empty()) {
+            _buffer.clear();
+            _buffer_file->resize(0);
+        }
+        ++_version;
+        if (_head.next != 0) { // put all the main nodes into the free list
+            _main_node last;
+            _read_main(_head.pre, last);
+            last.next = _head.free;
+            _write_main(_head.pre, last);
+            _head.free = _head.next;
+        }
         _head.next = 0;
         _head.pre = 0;
-        _list.seekp(0);
-        _list.write(reinterpret_cast<char*>(&_head), sizeof(_first_node));
+        _head_dirty = true;
+        _directory.clear();
+#ifdef BOOKSTORE_BLOOM_FILTER
+        if (_bloom != nullptr) _bloom->reset({});
+#endif
     }
 
     /**
-     * This function gets the point of the value of a certain key pair.
-     * If the key pair doesn't exist, a nullptr will be returned instead.
-     * <br><br>
-     * WARNING: If the function doesn't return a nullptr, ALWAYS free
-     * the memory whenever you don't need it.
-     * @param key1
-     * @param key2
-     * @return the point of the value of a certain key.
-     * <br>
-     * If the key pair doesn't exist, a nullptr will be returned instead.
+     * This function gets the value of a certain key.
+     * @param keys the fields of the key
+     * @return the value of a certain key, or std::nullopt if the key
+     * doesn't exist.
      */
-    valueType* get(const keyType1& key1, const keyType2& key2)
+    std::optional<valueType> get(const keyTypes&... keys)
     {
-        std::pair<ptr, int> position = _find_exact(key1, key2);
-        if (position.first == -1) return nullptr; // no such node
-
+        const _key key(keys...);
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        auto iter = _buffer.find(key);
+        if (iter != _buffer.end()) return iter->second;
         _main_node mainNode;
-        _list.seekg(position.first);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
+        std::pair<ptr, int> position = _find_exact(key, mainNode);
+        if (position.first == -1) return std::nullopt; // no such node
+
         if (position.second == -1) {
-            return new valueType(mainNode.value);
-        } else {
-            _node tmpNode;
-            _list.seekg(mainNode.target + position.second * sizeof(_node));
-            _list.read(reinterpret_cast<char*>(&tmpNode), sizeof(_node));
-            return new valueType(tmpNode.value);
+            return mainNode.value;
+        } else { // _find_exact has left the array in the block buffer
+            return _block[position.second].value;
         }
     }
 
-    std::vector<valueType> traverse()
+    /**
+     * This function gets the values of many keys at a time.  The keys are
+     * sorted, so that each main node is read at most once.
+     * @param keys the keys (see CompositeKeyTraits)
+     * @return the values of the keys in the same order (std::nullopt for
+     * a key that doesn't exist)
+     */
+    std::vector<std::optional<valueType>> multiGet(const std::vector<typename _traits::keyArgument>& keys)
     {
-        std::vector<valueType> values; // can be optimized
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        std::vector<std::optional<valueType>> values(keys.size());
+
+        // Sort the keys that are not in the write buffer (with their places in the given order)
+        std::vector<_node> given;
+        std::vector<size_t> order;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            given.push_back(_node{_traits::toKey(keys[i]), valueType()});
+            auto iter = _buffer.find(given.back().key);
+            if (iter != _buffer.end()) values[i] = iter->second;
+            else if (_may_contain(given.back().key)) order.push_back(i);
+        }
+        if (_head.next == 0) return values;
+        std::sort(order.begin(), order.end(),
+                  [&given](size_t lhs, size_t rhs) { return _less(given[lhs], given[rhs]); });
+        std::vector<_node> sorted;
+        for (size_t i : order) sorted.push_back(given[i]);
+
+        std::vector<_node> nodes;
         _main_node mainNode;
-        _node node;
-        ptr mainPtr = _head.next;
-        while (mainPtr != 0) {
-            _list.seekg(mainPtr);
-            _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-            values.emplace_back(mainNode.value);
-            for (int i = 0; i < mainNode.count; ++i) {
-                _list.seekg(mainNode.target + i * sizeof(_node));
-                _list.read(reinterpret_cast<char*>(&node), sizeof(_node));
-                values.emplace_back(node.value);
+        size_t index = 0;
+        while (index < sorted.size()) {
+            size_t directoryIndex = _search_directory(sorted[index].key);
+            size_t end = _group_end(sorted, index, directoryIndex);
+            _read_main(_directory[directoryIndex].target, mainNode);
+            _collect(mainNode, nodes);
+            for (; index < end; ++index) {
+                auto iter = std::lower_bound(nodes.begin(), nodes.end(), sorted[index], _less);
+                if (iter != nodes.end() && iter->key == sorted[index].key) values[order[index]] = iter->value;
             }
-            mainPtr = mainNode.next;
         }
-        return std::move(values);
+        return values;
     }
 
-    std::vector<valueType> traverse(const keyType1& key1)
+    /**
+     * This function inserts many key-value pairs at a time.  The data
+     * are sorted and merged into each main node at once, so that each
+     * main node is read and written at most once.
+     * <br><br>
+     * WARNING: the keys MUST be distinct, and none of them can be in the
+     * unrolled linked list.
+     * @param entries the key-value pairs (see CompositeKeyTraits)
+     */
+    void multiInsert(const std::vector<typename _traits::entryArgument>& entries)
     {
-        std::vector<valueType> values; // can be optimized
-
-        std::pair<ptr, int> position = _single_find(key1);
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (_buffer_capacity > 0) {
+            for (const auto& entry : entries) _buffer_write(_traits::toKey(entry), _traits::toValue(entry));
+            return;
+        }
+        std::vector<_node> sorted;
+        for (const auto& entry : entries) sorted.push_back(_to_node(entry));
+        std::sort(sorted.begin(), sorted.end(), _less);
+        _merge_insert(sorted);
+    }
 
-        // The case of there are no such key
-        if (position.first == -1) {
-            return std::move(values);
+    /**
+     * This function erases many keys at a time.  The keys are sorted, so
+     * that each main node is read and written at most once (except for
+     * merging or rebalancing a main node that becomes too small).
+     * @param keys the keys (see CompositeKeyTraits)
+     */
+    void multiErase(const std::vector<typename _traits::keyArgument>& keys)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (_buffer_capacity > 0) {
+            for (const auto& key : keys) _buffer_write(_traits::toKey(key), std::nullopt);
+            return;
+        }
+        std::vector<_node> sorted;
+        for (const auto& key : keys) {
+            if (_may_contain(_traits::toKey(key))) sorted.push_back(_node{_traits::toKey(key), valueType()});
         }
+        std::sort(sorted.begin(), sorted.end(), _less);
+        _merge_erase(sorted);
+    }
 
-        ptr Ptr = position.first;
-        _main_node mainNode;
-        _node node;
-        _list.seekg(Ptr);
-        _list.read(reinterpret_cast<char*>(&mainNode), sizeof(_main_node));
-        if (position.second != -1) {
-            // Traverse all the data in the array of the main node
-            for (int i = position.second; i < mainNode.count; ++i) {
-                _list.seekg(mainNode.target + i * sizeof(_node));
-                _list.read(reinterpret_cast<char*>(&node), sizeof(_node));
-                if (!(node.key1 == key1)) break;
-                values.emplace_back(node.value);
-            }
+    /**
+     * This function sets the number of writes kept in the write buffer.
+     * Once it is set, the insertions and erasures are put into a sorted
+     * buffer in the memory (and appended to the file
+     * "<fileName>_buffer" so that they are not lost).  When the buffer is
+     * full, the buffer is merged into the main nodes in a single pass.
+     * The lookups, the traversals and the cursors see the writes in it.
+     * @param capacity 0 to write to the main nodes directly
+     */
+    void setBufferCapacity(size_t capacity)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        _buffer_capacity = capacity;
+        if (capacity > 0) _open_buffer_file();
+        if (_buffer.size() >= capacity) _drain();
+    }
 
-            // Move to the next node
-            Ptr = mainNode.next;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&mainNode), sizeof(mainNode));
+    std::vector<valueType> traverse()
+    {
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        std::vector<valueType> values; // can be optimized
+        std::vector<_node> nodes;
+        size_t prefetched = 0;
+        for (size_t index = 0; index < _range_count(); ++index) {
+            nodes.clear();
+            _read_range(index, prefetched, nodes);
+            for (const _node& node : nodes) values.emplace_back(node.value);
         }
-        while (mainNode.key1 == key1) {
-            values.emplace_back(mainNode.value);
-
-            // Traverse all the data in the array of the main node
-            for (int i = 0; i < mainNode.count; ++i) {
-                _list.seekg(mainNode.target + i * sizeof(_node));
-                _list.read(reinterpret_cast<char*>(&node), sizeof(_node));
-                if (!(node.key1 == key1)) break;
-                values.emplace_back(node.value);
-            }
+        return std::move(values);
+    }
 
-            // Move to the next node
-            Ptr = mainNode.next;
-            _list.seekg(Ptr);
-            _list.read(reinterpret_cast<char*>(&mainNode), sizeof(mainNode));
+    /**
+     * This function returns the values whose leading fields of the key are
+     * the given ones, in the order of the keys.
+     * @param prefix the leading fields (no more than the fields of the key)
+     */
+    template <class... prefixTypes>
+    std::vector<valueType> traverse(const prefixTypes&... prefix)
+    {
+        const typename CompositePrefix<sizeof...(prefixTypes), keyTypes...>::type key(prefix...);
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        std::vector<valueType> values; // can be optimized
+        std::vector<_node> nodes;
+        size_t prefetched = 0;
+        for (size_t index = _prefix_range(key); index < _range_count(); ++index) {
+            nodes.clear();
+            _read_range(index, prefetched, nodes);
+            for (const _node& node : nodes) {
+                const int order = comparePrefix(node.key, key);
+                if (order > 0) return std::move(values);
+                if (order == 0) values.emplace_back(node.value);
+            }
         }
         return std::move(values);
     }
 
+    /**
+     * This function returns a cursor over all the values.
+     */
+    Cursor cursor()
+    {
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        return Cursor(this, 0, [](const _key&) { return false; }, [](const _key&) { return true; });
+    }
+
+    /**
+     * This function returns a cursor over the values whose leading fields
+     * of the key are the given ones.
+     * @param prefix the leading fields (no more than the fields of the key)
+     */
+    template <class... prefixTypes>
+    Cursor cursor(const prefixTypes&... prefix)
+    {
+        const typename CompositePrefix<sizeof...(prefixTypes), keyTypes...>::type key(prefix...);
+        std::shared_lock<FairSharedMutex> lock(_mutex);
+        return Cursor(this, _prefix_range(key), [&key](const _key& target) { return comparePrefix(target, key) < 0; },
+                      [key](const _key& target) { return comparePrefix(target, key) == 0; });
+    }
+
+    /**
+     * This function rewrites the whole list in the order of the keys.
+     * The main nodes will be placed one after another from the head of
+     * the file, and the free space will be given back to the system.
+     * <br><br>
+     * It is done by flush as well when most of the file is free.
+     */
+    void compact()
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        _compact();
+    }
+
+    /**
+     * This function replaces all the data in the list with the data in
+     * [begin, end).  The main nodes are filled and written one after
+     * another in a single pass, which is much faster than inserting the
+     * data one by one.
+     * <br><br>
+     * WARNING: the data MUST be sorted by the keys, and the keys MUST be distinct.
+     * @tparam Iterator an iterator to the key-value pairs (see CompositeKeyTraits)
+     * @param begin
+     * @param end
+     * @param fillFactor each main node gets fillFactor * nodeSize
+     * key-value pairs (at most 2 * nodeSize - 1)
+     */
+    template <class Iterator>
+    void bulkLoad(Iterator begin, Iterator end, double fillFactor = 1.0)
+    {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        _bulk_load(begin, end, fillFactor);
+    }
+
+    /**
+     * This function writes everything back, compacting the list at first
+     * if most of the file is free.
+     */
     void flush()
     {
+        std::unique_lock<FairSharedMutex> lock(_mutex);
+        if (_sparse()) _compact();
+        _write_back();
         _list.flush();
+#ifdef BOOKSTORE_BLOOM_FILTER
+        if (_bloom != nullptr) _bloom->flush();
+#endif
+        if (_buffer_file != nullptr) _buffer_file->flush();
     }
 };
 
+/**
+ * These are the lists of the keys of one field and two fields.
+ */
+template <class keyType, class valueType>
+using UnrolledLinkedList = CompositeUnrolledLinkedList<valueType, keyType>;
+
+template <class keyType1, class keyType2, class valueType>
+using DoubleUnrolledLinkedList = CompositeUnrolledLinkedList<valueType, keyType1, keyType2>;
+
 #endif // UNROLLED_LINKED_LIST